@@ -7,7 +7,10 @@
 
 #include "wave.h"
 #include "buffer.h"
+#include "mipmap.h"
 #include "granulator.h"
+#include "reverb.h"
+#include "loudness.h"
 
 #include "gesture.h"
 
@@ -16,6 +19,9 @@
 // #define RESET
 // #define HANDLE_MIDI
 // #define DEBUG
+// #define PSOLA // pitch-synchronous grains (clean transposition of pitched input)
+// #define REVERBERATE // feedback delay network on the grains
+// #define METER // loudness of the output on the display, in place of the cpu load
 #define PREALLOCATED // otherwise, dynamically allocated buffer
 
 using namespace daisy;
@@ -38,23 +44,47 @@ Pedal hw;
 const float holdseconds = 0.5;
 const size_t holdtime = tickrate * holdseconds;
 
-const int seconds = 15;
+const int seconds = 30;
 const size_t buffsize = seconds * SR;
 
+// 16-bit power-of-two buffer: buffsize rounds up to 2^21 samples (about 43 seconds, 4 MB)
+typedef PBuffer<S, Int16<S>> Recording;
+
 #ifdef PREALLOCATED
-S DSY_SDRAM_BSS data[buffsize]; // store 10-second buffer in SDRAM
-FBuffer<S>* source; // preallocated buffer
-#else
-Buffer<S>* source; // dynamically allocated buffer
+int16_t DSY_SDRAM_BSS data[Recording::footprint(buffsize)]; // store buffer in SDRAM
+int16_t DSY_SDRAM_BSS octaves[Mipmap<S, Recording>::footprint(Recording::capacity(buffsize))]; // decimated copies for transposed-up grains, also 16-bit (3 MB)
 #endif
+Recording* source;
+Mipmap<S, Recording>* mipmap; // writes source and its octaves
+Landmarks<S> landmarks; // zero crossings and onsets of the recording, for click-free grain onsets
 
 
 // create pointers to DSP objects; construct after hw.Init()
-Granulator<S>* granny;
+Granulator<S, 64, Recording>* granny;
+Windows<S> windows; // grain window shapes (Granary::shape)
 
 const size_t n_grans = 4;
 Granary<S> granaries[n_grans]; // grain request "metronomes"
 
+#ifdef PSOLA
+Pitchmarker<S> marker; // pitch marks of the recorded input
+#endif
+
+#ifdef REVERBERATE
+const S room = 0.1; // longest delay line, in seconds
+const S reverb_mix = 0.3;
+#ifdef PREALLOCATED
+S DSY_SDRAM_BSS reverb_memory[Reverb<S>::footprint(room)]; // delay lines in SDRAM
+#endif
+Reverb<S>* reverb;
+S wet[bsize]; // grains of the current block, then their reverberation
+#endif
+
+#ifdef METER
+Loudness<S> meter;
+S metered[bsize]; // left channel of the current block
+#endif
+
 // create a low-pass filter for ducking the ADC when the effect is powered up
 S adc_gain = 1;
 S adc_gain_prev = 1;
@@ -184,6 +214,10 @@ size_t holdcount = 0;
 bool holdready = true;
 bool speed_editing = false;
 bool just_saved = false;
+bool just_froze = false;
+bool freeze_armed = false; // freeze gesture begun, waiting for the footswitch to come up
+volatile bool freeze_request = false; // toggled in the callback, between samples
+bool frozen = false; // recording looped, grains keep playing
 
 // old knob values
 S old_knob_vals[Pedal::KnobI::KN];
@@ -270,11 +304,28 @@ void handleUI(Settings &P)
 		just_saved = true;
 	}
 
-	// only switch to editing mode if we haven't just saved a preset
+	// encoder held + right footswitch alone: freeze / thaw the recording. acted on when the footswitch
+	// is released, and called off if the left one joins in (that's the save gesture)
+	if (hw.encoders[0].Pressed() && hw.switches[1].RisingEdge() && !hw.switches[0].Pressed())
+	{
+		freeze_armed = true;
+		just_froze = true;
+	}
+
+	if (hw.switches[0].Pressed() || !hw.encoders[0].Pressed())
+		freeze_armed = false;
+
+	if (freeze_armed && hw.switches[1].FallingEdge())
+	{
+		freeze_armed = false;
+		freeze_request = true;
+	}
+
+	// only switch to editing mode if we haven't just saved a preset (or frozen)
 	if (hw.encoders[0].FallingEdge())
 	{
-		if (just_saved)
-			just_saved = false;
+		if (just_saved || just_froze)
+			just_saved = just_froze = false;
 		else
 			speed_editing = !speed_editing;
 	}		
@@ -371,12 +422,17 @@ void handleUI(Settings &P)
 		}
 	}
 
-	str = "G:" + std::to_string(granny->activity);
+	str = (frozen ? "G*" : "G:") + std::to_string(granny->activity);
 	cstr = str.c_str();
 	hw.display.SetCursor(colsPots * textHSpace, 5 * textHeight);
 	hw.display.WriteString(cstr, Font_6x8, true);
 
+#ifdef METER
+	Loudness<S>::Reading reading = meter.read();
+	str = "L:" + std::to_string((int)std::round(reading.shortterm));
+#else
 	str = "C:" + std::to_string((int)(100 * cpu.GetAvgCpuLoad() + 0.5)) + "%";
+#endif
 	cstr = str.c_str();
 	hw.display.SetCursor(colsPots * textHSpace, 6 * textHeight + textHeight / 2);
 	hw.display.WriteString(cstr, Font_6x8, true);
@@ -399,6 +455,7 @@ void handleUI(Settings &P)
 			granaries[i].instruct(0.01 * P.params[i][5], Granary<S>::warble);
 			granaries[i].instruct(P.params[i][0], Granary<S>::size);
 			granaries[i].instruct(P.params[i][3], Granary<S>::texture);
+			granaries[i].instruct(P.params[i][3], Granary<S>::shape); // smooth windows for steady textures, sharper ones as they roughen
 			// granaries[i].instruct(40 * P.params[i][1], Granary<S>::density);
 			granaries[i].instruct(120 * P.params[i][1] * P.params[i][1], Granary<S>::density);
 			granaries[i].instruct(P.params[i][4], Granary<S>::spray);
@@ -492,8 +549,20 @@ static void Callback(AudioHandle::InterleavingInputBuffer in,
 		processed = false;
 	}
 
-	static S offset, the_size, speed, gain, pan;
+	static S offset, the_size, speed, gain, pan, shape;
 	static int x, y, last_x = 0;	
+
+	if (freeze_request)
+	{
+		if (frozen)
+			granny->thaw();
+		else
+			granny->freeze();
+
+		frozen = !frozen;
+		freeze_request = false;
+	}
+
 	for (size_t i = 0; i < size; i += 2)
 	{
 		out[i] = out[i + 1] = 0;
@@ -508,7 +577,13 @@ static void Callback(AudioHandle::InterleavingInputBuffer in,
 		}
 
 		S in_sample = adc_gain * in[i];
-		source->write(in_sample);
+		mipmap->write(in_sample); // ignored while frozen
+		if (!frozen)
+			landmarks.write(in_sample);
+#ifdef PSOLA
+		if (!frozen)
+			marker.write(in_sample);
+#endif
 
 
 		static int waveform_width = colsPots * textHSpace - textWidth;
@@ -535,29 +610,56 @@ static void Callback(AudioHandle::InterleavingInputBuffer in,
 		{
 			for (size_t j = 0; j < n_grans; j++)
 			{
-				if (granaries[j].parameters(&offset, &the_size, &speed, &gain, &pan) && cpu.GetAvgCpuLoad() < cpu_thresh)
+				if (granaries[j].parameters(&offset, &the_size, &speed, &gain, &pan, &shape) && cpu.GetAvgCpuLoad() < cpu_thresh)
 				{
 					// hw.seed.PrintLine("Requested: size %f, speed %f, gain %f.", the_size, speed, gain);
-					granny->request(offset, the_size, speed, gain, 0);
+					granny->request(offset, the_size, speed, gain, 0, shape);
 				}
 			}
 
-			out[i] = limiter(in_sample + (*granny)());
+			S grains = (*granny)();
+#ifdef REVERBERATE
+			wet[i / 2] = grains;
+			out[i] = in_sample + grains; // limited once the reverb is mixed in
+#else
+			out[i] = limiter(in_sample + grains);
+#endif
 			out[i + 1] = out[i];
 		}
 		else
 		{
 			out[i] = 0;
 			out[i + 1] = 0;
+#ifdef REVERBERATE
+			wet[i / 2] = 0;
+#endif
 		}
 
 
-		source->tick();
+		mipmap->tick();
+		if (!frozen)
+			landmarks.tick();
+#ifdef PSOLA
+		if (!frozen)
+			marker.tick();
+#endif
 		granny->tick();
 		for (size_t j = 0; j < n_grans; j++)
 			granaries[j].tick();
 	}
 
+#ifdef REVERBERATE
+	reverb->process(wet, wet, size / 2); // one block pass, after the grains
+	for (size_t i = 0; i < size; i += 2)
+		out[i] = out[i + 1] = limiter(out[i] + reverb_mix * wet[i / 2]);
+#endif
+
+#ifdef METER
+	for (size_t i = 0; i < size; i += 2)
+		metered[i / 2] = out[i];
+	meter.process(metered, size / 2);
+#endif
+
 	hw.SetLed((Pedal::LedI)0, effectOn);
 
 	// S load = cpu.GetAvgCpuLoad();
@@ -606,12 +708,33 @@ int main(void)
 #endif
 
 #ifdef PREALLOCATED
-	source = new FBuffer<S>(data, buffsize); // preallocated buffer
+	source = new Recording(data, buffsize); // preallocated buffer
+	mipmap = new Mipmap<S, Recording>(source, octaves);
 #else
-	source = new Buffer<S>(buffsize); // dynamically allocated buffer
+	source = new Recording(buffsize); // dynamically allocated buffer
+	mipmap = new Mipmap<S, Recording>(source);
 #endif
 	
-	granny = new Granulator<S>(&hann, source);
+#ifdef REVERBERATE
+#ifdef PREALLOCATED
+	reverb = new Reverb<S>(room, reverb_memory);
+#else
+	reverb = new Reverb<S>(room);
+#endif
+	reverb->decay(2.5);
+#endif
+
+	granny = new Granulator<S, 64, Recording>(&hann, mipmap);
+	granny->snap(&landmarks);
+	granny->shapes(&windows);
+
+	for (size_t j = 0; j < n_grans; j++)
+	{
+		granaries[j].seed(j + 1); // fixed seeds: identical input renders identical grains
+#ifdef PSOLA
+		granaries[j].follow(&marker);
+#endif
+	}
 
 	hw.display.Fill(false);
 	hw.display.Update();
@@ -660,5 +783,9 @@ int main(void)
 	}
 
 	delete granny;
+#ifdef REVERBERATE
+	delete reverb;
+#endif
+	delete mipmap;
 	delete source;
 }
\ No newline at end of file
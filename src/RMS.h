@@ -2,39 +2,18 @@
 #ifndef RMSh
 
 #include "globals.h"
-#include "delay.h"
+#include "envelope.h"
 
 namespace soundmath
 {
-	template <typename T> class RMS
+	// windowed RMS over width samples (see Windowed; Mean and Peak are the cheaper followers)
+	template <typename T> class RMS : public Windowed<T>
 	{
 	public:
-		~RMS()
-		{
-			delete averager;
-		}
-
-		RMS(uint width = SR / 20) : width(width)
-		{
-			averager = new Delay<T>(2, width);
-			averager->coefficients({{0, 1}, {width, -1}}, {{1,-1}});
-		}
-
-		T operator()(T sample)
-		{
-			return sqrt((*averager)(sample * sample) / width);
-		}
-
-		void tick()
-		{
-			averager->tick();
-		}
-
-	private:
-		Delay<T>* averager;
-		int width;
+		RMS(uint width = SR / 20) : Windowed<T>(width) { }
+		~RMS() { }
 	};
 }
 
 #define RMSh
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,282 @@
+// bank.h
+#ifndef BANK
+
+#include "globals.h"
+#include <vector>
+
+namespace soundmath
+{
+	// filterbank with the same interface and response as Filterbank, but without Eigen: coefficients
+	// and histories are stored structure-of-arrays (one row of N per tap), so each filter runs only
+	// its own recursion and every inner loop is a contiguous, vectorizable pass across the filters
+	template <typename T, size_t N, size_t order> class Bank
+	{
+	public:
+		Bank(double k_p = 0.1, double k_g = 1) :
+			smoothing_p(relaxation(k_p)), smoothing_g(relaxation(k_g))
+		{
+			memset(forwards, 0, sizeof(forwards));
+			memset(backs, 0, sizeof(backs));
+			memset(inputs, 0, sizeof(inputs));
+			memset(outputs, 0, sizeof(outputs));
+
+			memset(preamps_in, 0, sizeof(preamps_in));
+			memset(preamps_out, 0, sizeof(preamps_out));
+			memset(gains_in, 0, sizeof(gains_in));
+			memset(gains_out, 0, sizeof(gains_out));
+		}
+
+		~Bank() { }
+
+		// initalize the nth filter's coefficients
+		void coefficients(int n, const std::vector<T>& forward, const std::vector<T>& back)
+		{
+			int coeffs = std::min<int>(order + 1, forward.size());
+			for (int i = 0; i < coeffs; i++)
+				forwards[i][n] = forward[i];
+
+			coeffs = std::min<int>(order, back.size());
+			for (int i = 0; i < coeffs; i++)
+				backs[i][n] = back[i];
+		}
+
+		// set nth filter's preamp coefficient
+		void boost(int n, T value)
+		{
+			preamps_in[n] = value;
+		}
+
+		// set all preamp coefficients
+		void boost(const std::vector<T>& values)
+		{
+			for (int i = 0; i < std::min<int>(N, values.size()); i++)
+				preamps_in[i] = values[i];
+		}
+
+		// set nth filter's mixdown coefficient
+		void mix(int n, T value)
+		{
+			gains_in[n] = value;
+		}
+
+		// set all mixdown coefficients
+		void mix(const std::vector<T>& values)
+		{
+			for (int i = 0; i < std::min<int>(N, values.size()); i++)
+				gains_in[i] = values[i];
+		}
+
+		// set all mixdown coefficients from an array of N (no allocation; for per-sample modulation)
+		void mix(const T* values)
+		{
+			memcpy(gains_in, values, N * sizeof(T));
+		}
+
+		void open()
+		{
+			for (size_t i = 0; i < N; i++)
+				gains_in[i] = 1;
+		}
+
+		// get the result of filters applied to a sample
+		T operator()(T sample)
+		{
+			if (!computed)
+				compute(sample);
+
+			const T* y = outputs[origin];
+			T out = 0;
+			for (size_t i = 0; i < N; i++)
+				out += gains_out[i] * y[i];
+			return out;
+		}
+
+		T operator()(T sample, T (*distortion)(T in))
+		{
+			if (!computed)
+				compute(sample);
+
+			const T* y = outputs[origin];
+			T out = 0;
+			for (size_t i = 0; i < N; i++)
+				out += distortion(gains_out[i] * y[i]);
+			return out;
+		}
+
+		// outputs of the individual filters for the current sample (valid after operator())
+		const T* bands()
+		{
+			return outputs[origin];
+		}
+
+		// timestep
+		void tick()
+		{
+			origin = (origin == 0) ? order : origin - 1;
+			computed = false;
+		}
+
+		// filter and mix n samples (like n calls of operator() then tick(), except that within each span
+		// of up to 64 samples the preamps and gains ramp linearly to where their smoothing would take them)
+		void process(const T* in, T* out, uint n)
+		{
+			while (n > 0)
+			{
+				uint m = std::min(n, chunk);
+				span(in, out, m);
+
+				in += m;
+				out += m;
+				n -= m;
+			}
+		}
+
+	private:
+		static constexpr uint chunk = 64;
+
+		// filters processed together in span(), their state held in locals
+		static constexpr size_t lanes = (N % 8 == 0) ? 8 : (N % 4 == 0) ? 4 : (N % 2 == 0) ? 2 : 1;
+
+		T smoothing_p, smoothing_g;
+
+		T forwards[order + 1][N]; // forwards[k][i]: coefficient of x[n - k] in filter i
+		T backs[order][N]; // backs[k][i]: coefficient of y[n - 1 - k]
+		T inputs[order + 1]; // shared input history, rings indexed from origin
+		T outputs[order + 1][N]; // one row of filter outputs per time step
+
+		T preamps_in[N], preamps_out[N], gains_in[N], gains_out[N];
+
+		size_t origin = 0; // row of the current time step; older rows follow it
+		bool computed = false; // flag in case of repeated calls to operator()
+
+		// row holding the sample k steps back
+		inline size_t row(size_t k)
+		{
+			size_t index = origin + k;
+			return (index > order) ? index - (order + 1) : index;
+		}
+
+		void compute(T sample)
+		{
+			for (size_t i = 0; i < N; i++)
+			{
+				preamps_out[i] = (1 - smoothing_p) * preamps_in[i] + smoothing_p * preamps_out[i];
+				gains_out[i] = (1 - smoothing_g) * gains_in[i] + smoothing_g * gains_out[i];
+			}
+
+			inputs[origin] = sample;
+
+			T* y = outputs[origin];
+			for (size_t i = 0; i < N; i++)
+				y[i] = 0;
+
+			for (size_t k = 0; k <= order; k++)
+			{
+				T x = inputs[row(k)];
+				const T* f = forwards[k];
+				for (size_t i = 0; i < N; i++)
+					y[i] += f[i] * x;
+			}
+
+			for (size_t i = 0; i < N; i++)
+				y[i] *= preamps_out[i];
+
+			for (size_t k = 0; k < order; k++)
+			{
+				const T* b = backs[k];
+				const T* past = outputs[row(k + 1)];
+				for (size_t i = 0; i < N; i++)
+					y[i] -= b[i] * past[i];
+			}
+
+			computed = true;
+		}
+
+		// m <= chunk samples, one group of filters at a time: coefficients, histories and ramps stay in
+		// locals for the whole span, and each sample's mixdown is one dot product across the group
+		void span(const T* in, T* out, uint m)
+		{
+			T x[order + chunk]; // inputs, oldest first; x[order + j] is in[j]
+			for (size_t k = 0; k < order; k++)
+				x[order - 1 - k] = inputs[row(k + 1)];
+			memcpy(x + order, in, m * sizeof(T));
+			memset(out, 0, m * sizeof(T));
+
+			T decay_p = pow(smoothing_p, m);
+			T decay_g = pow(smoothing_g, m);
+
+			for (size_t g = 0; g < N; g += lanes)
+			{
+				T f[order + 1][lanes], b[order][lanes], h[order][lanes]; // h[k]: y[n - 1 - k]
+				T preamp[lanes], dpreamp[lanes], gain[lanes], dgain[lanes];
+
+				for (size_t w = 0; w < lanes; w++)
+				{
+					for (size_t k = 0; k <= order; k++)
+						f[k][w] = forwards[k][g + w];
+					for (size_t k = 0; k < order; k++)
+					{
+						b[k][w] = backs[k][g + w];
+						h[k][w] = outputs[row(k + 1)][g + w];
+					}
+
+					// end of the span's ramps: where m steps of one-pole smoothing would land
+					T target = preamps_in[g + w] + (preamps_out[g + w] - preamps_in[g + w]) * decay_p;
+					preamp[w] = preamps_out[g + w];
+					dpreamp[w] = (target - preamp[w]) / m;
+					preamps_out[g + w] = target;
+
+					target = gains_in[g + w] + (gains_out[g + w] - gains_in[g + w]) * decay_g;
+					gain[w] = gains_out[g + w];
+					dgain[w] = (target - gain[w]) / m;
+					gains_out[g + w] = target;
+				}
+
+				for (uint j = 0; j < m; j++)
+				{
+					const T* past = x + order + j; // past[-k] is x[n - k]
+					T y[lanes];
+					T sum = 0;
+
+					for (size_t w = 0; w < lanes; w++)
+					{
+						T acc = 0;
+						for (size_t k = 0; k <= order; k++)
+							acc += f[k][w] * past[-(int)k];
+
+						preamp[w] += dpreamp[w];
+						acc *= preamp[w];
+
+						for (size_t k = 0; k < order; k++)
+							acc -= b[k][w] * h[k][w];
+						y[w] = acc;
+					}
+
+					for (size_t k = order - 1; k > 0; k--)
+						for (size_t w = 0; w < lanes; w++)
+							h[k][w] = h[k - 1][w];
+
+					for (size_t w = 0; w < lanes; w++)
+					{
+						h[0][w] = y[w];
+						gain[w] += dgain[w];
+						sum += gain[w] * y[w];
+					}
+
+					out[j] += sum;
+				}
+
+				for (size_t k = 0; k < order; k++)
+					for (size_t w = 0; w < lanes; w++)
+						outputs[row(k + 1)][g + w] = h[k][w];
+			}
+
+			for (size_t k = 0; k < order; k++)
+				inputs[row(k + 1)] = x[order + m - 1 - k];
+			computed = false;
+		}
+	};
+}
+
+#define BANK
+#endif
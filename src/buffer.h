@@ -1,14 +1,41 @@
 // buffer.h
 #include "globals.h"
+#include "kernels.h"
+#include "codecs.h"
+#include <cassert>
 
 #ifndef BUFFER
 
 namespace soundmath
 {
+	// turn the most recent size - fade samples of a circular buffer (origin is the next write) into a
+	// seamless loop, and return its length. get(i) and set(i, value) access samples at indices that
+	// the caller wraps, so one crossfade serves every storage layout
+	template <typename T, typename Get, typename Set> uint splice(uint origin, uint size, uint fade, Get get, Set set)
+	{
+		fade = std::clamp<uint>(fade, 2 * max_taps, size / 2);
+		uint length = size - fade;
+
+		// the loop's end is crossfaded into the material that preceded its start
+		for (uint j = 0; j < fade; j++)
+		{
+			T w = 0.5 * (1 - cos(PI * (j + 1) / (fade + 1)));
+			set(origin + length + j, (1 - w) * get(origin + length + j) + w * get(origin + j));
+		}
+
+		// repeat the loop's first samples after its end, for kernels reading across the seam
+		for (uint j = 0; j < max_taps; j++)
+			set(origin + j, get(origin + fade + j));
+
+		return length;
+	}
+
 	// circular buffer object
 	template <typename T> class Buffer
 	{
 	public:
+		typedef Raw<T> codec; // storage format
+
 		Buffer() { }
 
 		~Buffer()
@@ -32,6 +59,9 @@ namespace soundmath
 
 		inline void tick()
 		{
+			if (frozen)
+				return;
+
 			origin++;
 			origin %= size;
 		}
@@ -39,6 +69,9 @@ namespace soundmath
 		// linear-interpolated lookup (into past)
 		inline T operator()(T position = 0)
 		{
+			if (frozen)
+				position = fold(position);
+
 			int center = (int)position;
 			int before = center + 1;
 			T disp = position - center;
@@ -56,14 +89,94 @@ namespace soundmath
 			return data[(center + size) % size] * (1 - disp) + data[(after + size) % size] * disp;	
 		}
 
+		// lookup (into past) with a selectable interpolation kernel;
+		// wider kernels also read a few samples more recent than position (so keep it >= 4)
+		inline T operator()(T position, Quality quality)
+		{
+			if (frozen)
+				position = fold(position);
+
+			int center = (int)position;
+			T x[max_taps];
+			gather(x, center + 1 + before<T>(quality), taps<T>(quality));
+
+			return soundmath::interpolate(quality, x, 1 - (position - center));
+		}
+
+		// block lookup: out[i] = (*this)(position + i * increment, quality)
+		void interpolate(T* out, size_t n, T position, T increment, Quality quality)
+		{
+			switch (quality)
+			{
+				case Quality::hermite: return sweep<Hermite<T>>(out, n, position, increment);
+				case Quality::lagrange: return sweep<Lagrange<T>>(out, n, position, increment);
+				case Quality::sinc: return sweep<Sinc<T>>(out, n, position, increment);
+				default: return sweep<Linear<T>>(out, n, position, increment);
+			}
+		}
+
 		inline void write(T value)
 		{
-			data[origin] = value;
+			if (!frozen)
+				data[origin] = value;
 		}
 
 		inline void accum(T value)
 		{
-			data[origin] += value;
+			if (!frozen)
+				data[origin] += value;
+		}
+
+		// write n samples and advance past them (equivalent to n calls of write() then tick())
+		void write(const T* values, uint n)
+		{
+			if (frozen)
+				return;
+
+			if (n > size) // only the last size samples survive
+			{
+				values += n - size;
+				origin = (origin + n - size) % size;
+				n = size;
+			}
+
+			uint first = std::min(n, size - origin);
+			memcpy(data + origin, values, first * sizeof(T));
+			memcpy(data, values + first, (n - first) * sizeof(T));
+
+			origin = (origin + n) % size;
+		}
+
+		// copy the n samples ending at the given delay into out, oldest first
+		// (out[n - 1] is (*this)(delay); after a block write, the block is at delays n, ..., 1)
+		void read(T* out, uint delay, uint n)
+		{
+			uint start = (origin + 2 * size - delay - (n - 1)) % size;
+			uint first = std::min(n, size - start);
+			memcpy(out, data + start, first * sizeof(T));
+			memcpy(out + first, data, (n - first) * sizeof(T));
+		}
+
+		// loop the recording (call after tick(), before write()): writing and ticking stop, and reads
+		// wrap around the most recent size - fade samples. the loop's end is crossfaded into the
+		// material that preceded its start, so reads across the seam stay click-free
+		void freeze(uint fade)
+		{
+			length = splice<T>(origin, size, fade,
+				[this](uint i) { return data[i % size]; },
+				[this](uint i, T value) { data[i % size] = value; });
+			frozen = true;
+		}
+
+		// resume recording (the loop is overwritten as time goes on)
+		void thaw()
+		{
+			frozen = false;
+		}
+
+		inline bool is_frozen()
+		{
+			return frozen;
 		}
 
 		inline uint get_size()
@@ -80,6 +193,39 @@ namespace soundmath
 		T* data;
 		uint size;
 		uint origin;
+
+		bool frozen = false;
+		uint length; // of the frozen loop
+
+		// wrap a delay into the frozen loop, [1, length + 1)
+		inline T fold(T position)
+		{
+			return position - length * floor((position - 1) / length);
+		}
+
+		// copy n samples into x, oldest first, starting at the given delay
+		inline void gather(T* x, int delay, int n)
+		{
+			int index = ((int)origin - delay) % (int)size;
+			index += (index < 0) ? size : 0;
+			for (int k = 0; k < n; k++)
+			{
+				x[k] = data[index];
+				index += (index + 1 == (int)size) ? 1 - (int)size : 1;
+			}
+		}
+
+		template <typename K> void sweep(T* out, size_t n, T position, T increment)
+		{
+			T x[K::taps];
+			for (size_t i = 0; i < n; i++, position += increment)
+			{
+				T p = frozen ? fold(position) : position;
+				int center = (int)p;
+				gather(x, center + 1 + K::before, K::taps);
+				out[i] = K::eval(x, 1 - (p - center));
+			}
+		}
 	};
 
 	// circular buffer object: "fixed" buffer
@@ -98,6 +244,302 @@ namespace soundmath
 			this->origin = 0;
 		}
 	};
+
+	// circular buffer whose capacity is a power of two, indexed with masks rather than modulo.
+	// the first `guard` samples are mirrored past the end, so reads of up to `guard` consecutive
+	// samples (interpolation kernels, recent() spans) never wrap. samples are kept in the Codec's
+	// storage format (e.g. Int16) and converted to T inside the reads
+	template <typename T, typename Codec = Raw<T>, uint guard = max_taps> class PBuffer
+	{
+		typedef typename Codec::type U; // storage type
+
+	public:
+		typedef Codec codec;
+
+		// smallest power of two holding size samples
+		static constexpr size_t capacity(size_t size)
+		{
+			size_t capacity = guard;
+			while (capacity < size)
+				capacity <<= 1;
+			return capacity;
+		}
+
+		// samples of storage needed for a buffer of given size (including the mirrored guard)
+		static constexpr size_t footprint(size_t size)
+		{
+			return capacity(size) + guard;
+		}
+
+		PBuffer() { }
+
+		~PBuffer()
+		{
+			if (owner)
+				delete [] data;
+		}
+
+		void initialize(uint size = 0)
+		{
+			initialize(new U[footprint(size)], size);
+			owner = true;
+		}
+
+		// preallocated storage of at least footprint(size) samples
+		void initialize(U* data, uint size)
+		{
+			this->data = data;
+			this->size = capacity(size);
+			mask = this->size - 1;
+			origin = 0;
+			owner = false;
+			for (size_t i = 0; i < footprint(size); i++)
+				data[i] = Codec::encode(0);
+		}
+
+		PBuffer(uint size)
+		{
+			initialize(size);
+		}
+
+		PBuffer(U* data, size_t size)
+		{
+			initialize(data, size);
+		}
+
+		inline void tick()
+		{
+			if (!frozen)
+				origin = (origin + 1) & mask;
+		}
+
+		// linear-interpolated lookup (into past)
+		inline T operator()(T position = 0)
+		{
+			if (frozen)
+				position = fold(position);
+
+			int center = (int)position;
+			T disp = position - center;
+
+			// older sample first, so that the pair is contiguous (possibly in the guard)
+			const U* x = data + ((origin - center - 1) & mask);
+			return Codec::decode(x[1]) * (1 - disp) + Codec::decode(x[0]) * disp;
+		}
+
+		// linear-interpolated read (for static buffers)
+		inline T operator[](T position)
+		{
+			int center = (int)position;
+			T disp = position - center;
+
+			const U* x = data + (center & mask);
+			return Codec::decode(x[0]) * (1 - disp) + Codec::decode(x[1]) * disp;
+		}
+
+		// lookup (into past) with a selectable interpolation kernel;
+		// wider kernels also read a few samples more recent than position (so keep it >= 4)
+		inline T operator()(T position, Quality quality)
+		{
+			if (frozen)
+				position = fold(position);
+
+			int center = (int)position;
+			T scratch[max_taps];
+			const T* x = fetch((origin - center - 1 - before<T>(quality)) & mask, taps<T>(quality), scratch);
+
+			return soundmath::interpolate(quality, x, 1 - (position - center));
+		}
+
+		// block lookup: out[i] = (*this)(position + i * increment, quality)
+		void interpolate(T* out, size_t n, T position, T increment, Quality quality)
+		{
+			switch (quality)
+			{
+				case Quality::hermite: return sweep<Hermite<T>>(out, n, position, increment);
+				case Quality::lagrange: return sweep<Lagrange<T>>(out, n, position, increment);
+				case Quality::sinc: return sweep<Sinc<T>>(out, n, position, increment);
+				default: return sweep<Linear<T>>(out, n, position, increment);
+			}
+		}
+
+		inline void write(T value)
+		{
+			if (frozen)
+				return;
+
+			U encoded = Codec::encode(value);
+			data[origin] = encoded;
+			data[mirror()] = encoded;
+		}
+
+		inline void accum(T value)
+		{
+			write(Codec::decode(data[origin]) + value);
+		}
+
+		// write n samples and advance past them (equivalent to n calls of write() then tick())
+		void write(const T* values, uint n)
+		{
+			if (frozen)
+				return;
+
+			if (n > size) // only the last size samples survive
+			{
+				values += n - size;
+				origin = (origin + n - size) & mask;
+				n = size;
+			}
+
+			uint first = std::min(n, size - origin);
+			encode(data + origin, values, first);
+			encode(data, values + first, n - first);
+
+			// refresh the mirrored guard if the block touched it
+			if (origin < guard || n > first)
+				memcpy(data + size, data, guard * sizeof(U));
+
+			origin = (origin + n) & mask;
+		}
+
+		// copy the n samples ending at the given delay into out, oldest first
+		// (out[n - 1] is (*this)(delay); after a block write, the block is at delays n, ..., 1)
+		void read(T* out, uint delay, uint n)
+		{
+			uint start = (origin - delay - (n - 1)) & mask;
+			uint first = std::min(n, size - start);
+			decode(out, data + start, first);
+			decode(out + first, data, n - first);
+		}
+
+		// contiguous view of the n most recently completed samples (delays n, ..., 1), oldest first.
+		// n may not exceed guard: only that many samples are mirrored, so longer spans would run off the end
+		inline const T* recent(uint n)
+		{
+			static_assert(Codec::raw, "spans need raw storage");
+			assert(n <= guard);
+			return data + ((origin - n) & mask);
+		}
+
+		// loop the recording (call after tick(), before write()): writing and ticking stop, and reads
+		// wrap around the most recent size - fade samples. the loop's end is crossfaded into the
+		// material that preceded its start, so reads across the seam stay click-free
+		void freeze(uint fade)
+		{
+			length = splice<T>(origin, size, fade,
+				[this](uint i) { return Codec::decode(data[i & mask]); },
+				[this](uint i, T value) { put(i & mask, value); });
+			frozen = true;
+		}
+
+		// resume recording (the loop is overwritten as time goes on)
+		void thaw()
+		{
+			frozen = false;
+		}
+
+		inline bool is_frozen()
+		{
+			return frozen;
+		}
+
+		inline uint get_size()
+		{
+			return size;
+		}
+
+		inline uint get_origin()
+		{
+			return origin;
+		}
+
+	protected:
+		U* data;
+		uint size;
+		uint mask;
+		uint origin;
+		bool owner = false;
+
+		bool frozen = false;
+		uint length; // of the frozen loop
+
+		// wrap a delay into the frozen loop, [1, length + 1)
+		inline T fold(T position)
+		{
+			return position - length * floor((position - 1) / length);
+		}
+
+		// store a sample at an index, keeping the guard in sync
+		inline void put(uint index, T value)
+		{
+			data[index] = Codec::encode(value);
+			if (index < guard)
+				data[index + size] = data[index];
+		}
+
+		// position of the guard copy of the current sample (itself, if outside the guard)
+		inline uint mirror()
+		{
+			return origin < guard ? origin + size : origin;
+		}
+
+		// n consecutive samples from index, as T (decoded into scratch unless stored raw)
+		inline const T* fetch(uint index, int n, T* scratch)
+		{
+			if constexpr (Codec::raw)
+				return data + index;
+			else
+			{
+				for (int k = 0; k < n; k++)
+					scratch[k] = Codec::decode(data[index + k]);
+				return scratch;
+			}
+		}
+
+		static inline void encode(U* out, const T* in, uint n)
+		{
+			if constexpr (Codec::raw)
+				memcpy(out, in, n * sizeof(T));
+			else
+				for (uint i = 0; i < n; i++)
+					out[i] = Codec::encode(in[i]);
+		}
+
+		static inline void decode(T* out, const U* in, uint n)
+		{
+			if constexpr (Codec::raw)
+				memcpy(out, in, n * sizeof(T));
+			else
+				for (uint i = 0; i < n; i++)
+					out[i] = Codec::decode(in[i]);
+		}
+
+		// positions and fractions are computed a chunk at a time (a loop that vectorizes),
+		// then each kernel reads its taps straight from the buffer
+		template <typename K> void sweep(T* out, size_t n, T position, T increment)
+		{
+			const size_t chunk = 16;
+			uint indices[chunk];
+			T fractions[chunk];
+			T scratch[K::taps];
+
+			for (size_t i = 0; i < n; i += chunk)
+			{
+				size_t m = std::min(chunk, n - i);
+				for (size_t j = 0; j < m; j++)
+				{
+					T p = position + (i + j) * increment;
+					p = frozen ? fold(p) : p;
+					int center = (int)p;
+					indices[j] = (origin - center - 1 - K::before) & mask;
+					fractions[j] = 1 - (p - center);
+				}
+
+				for (size_t j = 0; j < m; j++)
+					out[i + j] = K::eval(fetch(indices[j], K::taps, scratch), fractions[j]);
+			}
+		}
+	};
 }
 
 #define BUFFER
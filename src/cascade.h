@@ -0,0 +1,253 @@
+// cascade.h
+#ifndef CASCADE
+
+#include "globals.h"
+#include "filter.h"
+#include <complex>
+
+namespace soundmath
+{
+	// high-order filter as a cascade of biquads. the designer pairs each pole pair with its nearest
+	// zeros (most resonant sections last) and scales the sections so the running response peaks at
+	// unity after each one; far better conditioned in float than one expanded polynomial
+	template <typename T, size_t sections> class Cascade
+	{
+		typedef std::complex<T> C;
+
+	public:
+		Cascade()
+		{
+			clear();
+		}
+
+		~Cascade() { }
+
+		// true roots of numerator and denominator; complex roots must come in conjugate pairs
+		// (only the member with positive imaginary part is used). order must not exceed 2 * sections
+		Cascade(T gain, const std::vector<C>& zeros, const std::vector<C>& poles)
+		{
+			design(gain, zeros, poles);
+		}
+
+		// same transfer function as Filter<T>(gain, zeros, poles), whose factors are (1 + r / z)
+		Cascade(T gain, const std::vector<T>& zeros, const std::vector<T>& poles)
+		{
+			std::vector<C> z, p;
+			for (T r : zeros)
+				z.push_back(-r);
+			for (T r : poles)
+				p.push_back(-r);
+			design(gain, z, p);
+		}
+
+		void design(T gain, const std::vector<C>& zeros, const std::vector<C>& poles)
+		{
+			clear();
+
+			std::vector<C> z = halve(zeros), p = halve(poles);
+
+			// poles nearest the unit circle get first pick of the zeros
+			std::sort(p.begin(), p.end(), [](C a, C b) { return std::abs(a) > std::abs(b); });
+
+			T numerators[sections][3], denominators[sections][3];
+			size_t count = 0;
+
+			while ((!p.empty() || !z.empty()) && count < sections)
+			{
+				C chosen[2], roots[2];
+				size_t nz = 0, np = 0;
+
+				if (!p.empty())
+				{
+					roots[np++] = p.front();
+					p.erase(p.begin());
+					if (real(roots[0]) && !p.empty()) // a real pole shares its section with the next real one
+						for (size_t i = 0; i < p.size(); i++)
+							if (real(p[i]))
+							{
+								roots[np++] = p[i];
+								p.erase(p.begin() + i);
+								break;
+							}
+				}
+
+				if (!z.empty())
+				{
+					C target = np ? roots[0] : z.front();
+					size_t nearest = closest(z, target);
+					chosen[nz++] = z[nearest];
+					z.erase(z.begin() + nearest);
+
+					if (real(chosen[0]) && !z.empty()) // a real zero pairs with the next nearest real one
+					{
+						size_t i = closest(z, target, true);
+						if (i < z.size())
+						{
+							chosen[nz++] = z[i];
+							z.erase(z.begin() + i);
+						}
+					}
+				}
+
+				expand(chosen, nz, numerators[count]);
+				expand(roots, np, denominators[count]);
+				count++;
+			}
+
+			if (count == 0) // a plain gain
+			{
+				expand(nullptr, 0, numerators[0]);
+				expand(nullptr, 0, denominators[0]);
+				count = 1;
+			}
+
+			// most resonant sections last, to keep the signal small inside the cascade
+			std::reverse(numerators, numerators + count);
+			std::reverse(denominators, denominators + count);
+
+			// gain staging: the running response peaks at unity after every section, and the last
+			// section restores the overall gain
+			std::vector<C> running(resolution, 1);
+			T product = 1;
+			for (size_t k = 0; k < count; k++)
+			{
+				T maximum = 0;
+				for (size_t i = 0; i < resolution; i++)
+				{
+					C w = std::polar<T>(1, -PI * i / (resolution - 1));
+					running[i] *= evaluate(numerators[k], w) / evaluate(denominators[k], w);
+					maximum = std::max(maximum, std::abs(running[i]));
+				}
+
+				T scale = (maximum > 0) ? 1 / maximum : 1;
+				if (k == count - 1)
+					scale = gain / product;
+				product *= scale;
+
+				for (size_t i = 0; i < 3; i++)
+					numerators[k][i] *= scale;
+				for (size_t i = 0; i < resolution; i++)
+					running[i] *= scale;
+			}
+
+			for (size_t k = 0; k < count; k++)
+				stages[k].coefficients(numerators[k], denominators[k]);
+		}
+
+		void reset()
+		{
+			for (size_t k = 0; k < sections; k++)
+				stages[k].reset();
+		}
+
+		T operator()(T sample)
+		{
+			if (!computed)
+			{
+				out = sample;
+				for (size_t k = 0; k < sections; k++)
+				{
+					out = stages[k](out);
+					stages[k].tick();
+				}
+				computed = true;
+			}
+
+			return out;
+		}
+
+		void tick()
+		{
+			computed = false;
+		}
+
+		// n samples through every section in turn (in and out may be the same)
+		void process(const T* in, T* out, uint n)
+		{
+			stages[0].process(in, out, n);
+			for (size_t k = 1; k < sections; k++)
+				stages[k].process(out, out, n);
+		}
+
+	private:
+		static const size_t resolution = 512; // frequencies checked for gain staging
+
+		Filter<T, 2> stages[sections];
+		T out = 0;
+		bool computed = false;
+
+		void clear()
+		{
+			T identity[3] = {1, 0, 0};
+			T none[3] = {0, 0, 0};
+			for (size_t k = 0; k < sections; k++)
+			{
+				stages[k].coefficients(identity, none);
+				stages[k].reset();
+			}
+			computed = false;
+		}
+
+		static bool real(C r)
+		{
+			return std::abs(r.imag()) <= 1e-6 * std::max<T>(1, std::abs(r));
+		}
+
+		// one root of each conjugate pair, plus the real roots
+		static std::vector<C> halve(const std::vector<C>& roots)
+		{
+			std::vector<C> kept;
+			for (C r : roots)
+				if (real(r))
+					kept.push_back(C(r.real(), 0));
+				else if (r.imag() > 0)
+					kept.push_back(r);
+			return kept;
+		}
+
+		static size_t closest(const std::vector<C>& roots, C target, bool reals = false)
+		{
+			size_t best = roots.size();
+			T distance = 0;
+			for (size_t i = 0; i < roots.size(); i++)
+			{
+				if (reals && !real(roots[i]))
+					continue;
+				T d = std::abs(roots[i] - target);
+				if (best == roots.size() || d < distance)
+				{
+					best = i;
+					distance = d;
+				}
+			}
+			return best;
+		}
+
+		// coefficients of 1, 1/z, 1/z^2 with the given roots (a complex root brings its conjugate)
+		static void expand(const C* roots, size_t n, T* c)
+		{
+			c[0] = 1;
+			c[1] = c[2] = 0;
+			if (n == 1 && !real(roots[0]))
+			{
+				c[1] = -2 * roots[0].real();
+				c[2] = std::norm(roots[0]);
+			}
+			else if (n == 1)
+				c[1] = -roots[0].real();
+			else if (n == 2)
+			{
+				c[1] = -(roots[0].real() + roots[1].real());
+				c[2] = roots[0].real() * roots[1].real();
+			}
+		}
+
+		static C evaluate(const T* c, C w) // w = 1/z
+		{
+			return c[0] + w * (c[1] + w * c[2]);
+		}
+	};
+}
+
+#define CASCADE
+#endif
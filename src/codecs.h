@@ -0,0 +1,76 @@
+// codecs.h
+#ifndef CODECS
+
+#include "globals.h"
+#include <cstdint>
+
+namespace soundmath
+{
+	// sample storage formats for buffers: encode on write, decode inside the read kernels
+
+	// samples stored as they are
+	template <typename T> struct Raw
+	{
+		typedef T type;
+		static const bool raw = true;
+
+		static inline T encode(T x) { return x; }
+		static inline T decode(T x) { return x; }
+	};
+
+	// 16-bit linear PCM in [-1, 1] (half the bytes of float)
+	template <typename T> struct Int16
+	{
+		typedef int16_t type;
+		static const bool raw = false;
+
+		static inline int16_t encode(T x)
+		{
+			x = std::clamp<T>(x, -1, 1) * 32767;
+			return (int16_t)(x + (x < 0 ? -0.5 : 0.5));
+		}
+
+		static inline T decode(int16_t x)
+		{
+			return x * (T)(1.0 / 32767);
+		}
+	};
+
+	// 8-bit mu-law (a quarter of the bytes of float, with about 13 bits of dynamic range)
+	template <typename T> struct MuLaw
+	{
+		typedef uint8_t type;
+		static const bool raw = false;
+
+		static inline uint8_t encode(T x)
+		{
+			static const T scale = 127 / log(256.0);
+			T magnitude = log(1 + 255 * std::min<T>(std::abs(x), 1)) * scale;
+			return (uint8_t)((x < 0) << 7 | (uint8_t)(magnitude + 0.5));
+		}
+
+		static inline T decode(uint8_t x)
+		{
+			static const Table table;
+			return table.values[x];
+		}
+
+	private:
+		struct Table
+		{
+			T values[256];
+
+			Table()
+			{
+				for (int i = 0; i < 256; i++)
+				{
+					T magnitude = (pow(256.0, (i & 127) / 127.0) - 1) / 255;
+					values[i] = (i & 128) ? -magnitude : magnitude;
+				}
+			}
+		};
+	};
+}
+
+#define CODECS
+#endif
@@ -20,13 +20,15 @@ namespace soundmath
 		{
 			delete [] forwards;
 			delete [] backs;
+			delete [] nearby;
 		}
 
 		// initialize N delays of given sparsity and maximum time
-		Delay(uint sparsity, uint time) : input(time + 1), output(time + 1)
+		Delay(uint sparsity, uint time) : input(time + chunk + 1), output(time + chunk + 1)
 		{
 			forwards = new std::pair<uint, T>[sparsity]; 
 			backs = new std::pair<uint, T>[sparsity];
+			nearby = new std::pair<uint, T>[sparsity];
 
 			for (size_t i = 0; i < sparsity; i++)
 			{
@@ -36,6 +38,7 @@ namespace soundmath
 
 			this->sparsity = sparsity;
 			computed = false;
+			recursions = 0;
 		}
 
 		// initalize coefficients
@@ -57,6 +60,8 @@ namespace soundmath
 			}
 			for (size_t i = order; i < sparsity; i++)
 				backs[i] = {0, 0}; // zero out trailing coefficients
+
+			measure();
 		}
 
 		// modulate the feedforward coeffs of nth delay
@@ -70,6 +75,8 @@ namespace soundmath
 				backs[n] = {0, 0};
 			else
 				backs[n] = back;
+
+			measure();
 		}
 
 		// get the result of filter applied to a sample
@@ -101,15 +108,84 @@ namespace soundmath
 			computed = false;
 		}
 
+		// filter n samples (equivalent to n calls of operator() then tick()). each feed-forward tap, and
+		// each feedback tap at least a span long, becomes a multiply-add over a contiguous span; shorter
+		// feedback (e.g. a running sum's delay of 1) runs as a recursion over the span's own output
+		void process(const T* in, T* out, uint n)
+		{
+			T history[2 * chunk]; // the previous chunk of output, then the span's
+			T* sum = history + chunk;
+			T span[chunk];
+
+			while (n > 0)
+			{
+				uint m = std::min(n, chunk);
+
+				input.write(in, m); // samples now at delays m, ..., 1
+				memset(sum, 0, m * sizeof(T));
+
+				for (size_t i = 0; i < sparsity; i++)
+				{
+					std::pair<uint, T> forward = forwards[i];
+					if (forward.second == 0)
+						continue;
+
+					input.read(span, forward.first + 1, m);
+					for (uint j = 0; j < m; j++)
+						sum[j] += forward.second * span[j];
+				}
+
+				for (size_t i = 0; i < sparsity; i++)
+				{
+					std::pair<uint, T> back = backs[i];
+					if (back.second == 0 || back.first < chunk)
+						continue;
+
+					output.read(span, back.first - m + 1, m);
+					for (uint j = 0; j < m; j++)
+						sum[j] -= back.second * span[j];
+				}
+
+				if (recursions > 0)
+				{
+					output.read(history, 1, chunk);
+					for (uint j = 0; j < m; j++)
+						for (size_t k = 0; k < recursions; k++)
+							sum[j] -= nearby[k].second * sum[(int)j - (int)nearby[k].first];
+				}
+
+				output.write(sum, m);
+				memcpy(out, sum, m * sizeof(T));
+
+				in += m;
+				out += m;
+				n -= m;
+			}
+
+			computed = false;
+		}
+
 	private:
-		Buffer<T> input; // circular buffers of inputs and outputs
-		Buffer<T> output; 
+		static constexpr uint chunk = 64; // longest span processed at once
+		PBuffer<T> input; // circular buffers of inputs and outputs
+		PBuffer<T> output; 
 		uint sparsity;
 
 		std::pair<uint, T>* forwards; // feedforward times and coefficients
 		std::pair<uint, T>* backs; // feedback times and coefficients
 
 		bool computed; // flag in case of repeated calls to operator()
+
+		std::pair<uint, T>* nearby; // feedback taps shorter than a span (run recursively in process())
+		size_t recursions;
+
+		void measure()
+		{
+			recursions = 0;
+			for (size_t i = 0; i < sparsity; i++)
+				if (backs[i].second != 0 && backs[i].first < chunk)
+					nearby[recursions++] = backs[i];
+		}
 	};
 }
 
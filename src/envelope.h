@@ -0,0 +1,226 @@
+// envelope.h
+#ifndef ENVELOPE
+
+#include "globals.h"
+
+namespace soundmath
+{
+	// level detectors. each has the per-sample interface (operator() then tick()), a block
+	// process(in, out, n), and a decimated process(in, n) that returns only the level after the block
+
+	// exponentially weighted RMS; time is the averaging time constant in seconds
+	template <typename T> class Mean
+	{
+	public:
+		Mean(T time = 0.05)
+		{
+			smoothing(time);
+		}
+
+		~Mean() { }
+
+		void smoothing(T time)
+		{
+			coefficient = 1 - exp(-1 / (SR * time));
+		}
+
+		T operator()(T sample)
+		{
+			if (!computed)
+			{
+				square += coefficient * (sample * sample - square);
+				computed = true;
+			}
+
+			return sqrt(square);
+		}
+
+		void tick()
+		{
+			computed = false;
+		}
+
+		void process(const T* in, T* out, uint n)
+		{
+			T s = square;
+			for (uint j = 0; j < n; j++)
+			{
+				s += coefficient * (in[j] * in[j] - s);
+				out[j] = sqrt(s);
+			}
+			square = s;
+			computed = false;
+		}
+
+		T process(const T* in, uint n)
+		{
+			T s = square;
+			for (uint j = 0; j < n; j++)
+				s += coefficient * (in[j] * in[j] - s);
+			square = s;
+			computed = false;
+			return sqrt(s);
+		}
+
+	private:
+		T coefficient;
+		T square = 0;
+		bool computed = false;
+	};
+
+	// peak follower with separate attack and release time constants (seconds)
+	template <typename T> class Peak
+	{
+	public:
+		Peak(T attack = 0.001, T release = 0.1)
+		{
+			times(attack, release);
+		}
+
+		~Peak() { }
+
+		void times(T attack, T release)
+		{
+			rise = 1 - exp(-1 / (SR * attack));
+			fall = 1 - exp(-1 / (SR * release));
+		}
+
+		T operator()(T sample)
+		{
+			if (!computed)
+			{
+				level = follow(level, sample);
+				computed = true;
+			}
+
+			return level;
+		}
+
+		void tick()
+		{
+			computed = false;
+		}
+
+		void process(const T* in, T* out, uint n)
+		{
+			T l = level;
+			for (uint j = 0; j < n; j++)
+				out[j] = l = follow(l, in[j]);
+			level = l;
+			computed = false;
+		}
+
+		T process(const T* in, uint n)
+		{
+			T l = level;
+			for (uint j = 0; j < n; j++)
+				l = follow(l, in[j]);
+			level = l;
+			computed = false;
+			return l;
+		}
+
+	private:
+		T rise, fall;
+		T level = 0;
+		bool computed = false;
+
+		inline T follow(T l, T sample)
+		{
+			T x = std::abs(sample);
+			return l + ((x > l) ? rise : fall) * (x - l);
+		}
+	};
+
+	// exact RMS over the last width samples: one ring of squares and a running sum. a second sum
+	// collects the current lap's squares from zero and replaces the running one at each lap, so
+	// rounding errors can't accumulate and no sample pays for more than a few adds
+	template <typename T> class Windowed
+	{
+	public:
+		Windowed(uint width = SR / 20) : width(width)
+		{
+			squares = new T[width];
+			memset(squares, 0, width * sizeof(T));
+		}
+
+		~Windowed()
+		{
+			delete [] squares;
+		}
+
+		T operator()(T sample)
+		{
+			if (!computed)
+			{
+				T square = sample * sample;
+				sum += square - squares[index];
+				lap += square;
+				squares[index] = square;
+				computed = true;
+			}
+
+			return level();
+		}
+
+		void tick()
+		{
+			advance();
+			computed = false;
+		}
+
+		void process(const T* in, T* out, uint n)
+		{
+			for (uint j = 0; j < n; j++)
+			{
+				push(in[j]);
+				out[j] = level();
+			}
+			computed = false;
+		}
+
+		T process(const T* in, uint n)
+		{
+			for (uint j = 0; j < n; j++)
+				push(in[j]);
+			computed = false;
+			return level();
+		}
+
+	private:
+		T* squares;
+		uint width;
+		uint index = 0;
+		T sum = 0;
+		T lap = 0; // squares written since index was last 0
+		bool computed = false;
+
+		inline T level()
+		{
+			return sqrt(std::max<T>(sum, 0) / width);
+		}
+
+		inline void push(T sample)
+		{
+			T square = sample * sample;
+			sum += square - squares[index];
+			lap += square;
+			squares[index] = square;
+			advance();
+		}
+
+		inline void advance()
+		{
+			if (++index < width)
+				return;
+
+			// the ring now holds exactly this lap's squares
+			index = 0;
+			sum = lap;
+			lap = 0;
+		}
+	};
+}
+
+#define ENVELOPE
+#endif
@@ -6,7 +6,129 @@
 
 namespace soundmath
 {
-	template <typename T> class Filter
+	// filter of fixed order: coefficients and state live inline, and samples run through a
+	// transposed direct form II recurrence (no heap, no modulo). order 0 selects the
+	// runtime-order filter below
+	template <typename T, size_t order = 0> class Filter
+	{
+	public:
+		Filter()
+		{
+			for (size_t i = 0; i <= order; i++)
+				forward[i] = back[i] = 0;
+			reset();
+		}
+
+		~Filter() { }
+
+		// feedforward and feedback coefficients as for the runtime-order filter (back[0] is ignored)
+		Filter(const std::vector<T>& feedforward, const std::vector<T>& feedback) : Filter()
+		{
+			for (size_t i = 0; i < std::min(order + 1, feedforward.size()); i++)
+				forward[i] = feedforward[i];
+			for (size_t i = 1; i < std::min(order + 1, feedback.size()); i++)
+				back[i] = feedback[i];
+		}
+
+		// replace the coefficients (order + 1 of each) without touching the state
+		void coefficients(const T* feedforward, const T* feedback)
+		{
+			for (size_t i = 0; i <= order; i++)
+			{
+				forward[i] = feedforward[i];
+				back[i] = feedback[i];
+			}
+			back[0] = 0;
+		}
+
+		void reset()
+		{
+			for (size_t i = 0; i < order; i++)
+				state[i] = 0;
+			out = 0;
+			computed = false;
+		}
+
+		void tick()
+		{
+			computed = false;
+		}
+
+		T operator()(T sample)
+		{
+			if (!computed)
+			{
+				out = step(sample, state);
+				computed = true;
+			}
+
+			return out;
+		}
+
+		// filter n samples (equivalent to n calls of operator() then tick()); in and out may be the same
+		void process(const T* in, T* out, uint n)
+		{
+			T local[order];
+			for (size_t i = 0; i < order; i++)
+				local[i] = state[i];
+
+			for (uint j = 0; j < n; j++)
+				out[j] = step(in[j], local);
+
+			for (size_t i = 0; i < order; i++)
+				state[i] = local[i];
+			computed = false;
+		}
+
+		// as Filter<T>::resonant
+		void resonant(T frequency, T Q)
+		{
+			static_assert(order == 2, "resonant() is a biquad");
+
+			T cosine = cos(2 * PI * frequency / SR);
+			std::complex<T> rotation(cos(4 * PI * frequency / SR), sin(4 * PI * frequency / SR));
+			std::complex<T> maximum = (T)1 / (Q - 1) - (T)1 / (Q - rotation);
+			T amplitude = 1 / sqrt(std::abs(maximum));
+
+			T feedforward[3] = {amplitude, 0, -amplitude};
+			T feedback[3] = {0, -2 * Q * cosine, Q * Q};
+			coefficients(feedforward, feedback);
+		}
+
+		// as Filter<T>::bandpass
+		void bandpass(T frequency, T Q)
+		{
+			static_assert(order == 2, "bandpass() is a biquad");
+
+			T theta = 2 * PI * frequency / SR;
+			T beta = 0.5 * (1 - tan(theta / (2 * Q))) / (1 + tan(theta / (2 * Q)));
+			T gamma = cos(theta) * (0.5 + beta);
+			T alpha = 0.5 * (0.5 - beta);
+
+			T feedforward[3] = {2 * alpha, 0, -2 * alpha};
+			T feedback[3] = {0, -gamma, beta};
+			coefficients(feedforward, feedback);
+		}
+
+	private:
+		T forward[order + 1];
+		T back[order + 1];
+		T state[order];
+		T out;
+		bool computed;
+
+		inline T step(T sample, T* s)
+		{
+			T y = forward[0] * sample + s[0];
+			for (size_t i = 1; i < order; i++)
+				s[i - 1] = forward[i] * sample - back[i] * y + s[i];
+			s[order - 1] = forward[order] * sample - back[order] * y;
+			return y;
+		}
+	};
+
+	// filter whose order is chosen at runtime
+	template <typename T> class Filter<T, 0>
 	{
 	public:
 		Filter() { }
@@ -1,21 +1,31 @@
 // granulator.h
 #include "globals.h"
 #include "wave.h"
+#include "windows.h"
 #include "buffer.h"
+#include "mipmap.h"
+#include "landmarks.h"
 #include "noise.h"
 #include "metro.h"
+#include "pitchmarks.h"
 
 #ifndef GRANULATOR
 
 namespace soundmath
 {
-	template <typename T, size_t polyphony = 64> class Granulator
+	// B is the source buffer type (Buffer, FBuffer, PBuffer)
+	template <typename T, size_t polyphony = 64, typename B = Buffer<T>> class Granulator
 	{
 	public:
+		// where grain onsets snap to
+		static const int free = 0;
+		static const int crossings = 1;
+		static const int onsets = 2;
+
 		Granulator() { }
 		~Granulator() { }
 
-		Granulator(Wave<T>* window, Buffer<T>* source) :
+		Granulator(Wave<T>* window, B* source) :
 			window(window), source(source), size(source->get_size())
 		{
 			memset(ticks, 0, polyphony * sizeof(size_t));
@@ -25,15 +35,94 @@ namespace soundmath
 			memset(gains, 0, polyphony * sizeof(T));
 			// memset(pans, 0, polyphony * sizeof(T));
 			memset(active, false, polyphony * sizeof(bool));
+			memset(levels, 0, polyphony * sizeof(size_t));
+			for (size_t i = 0; i < polyphony; i++)
+				qualities[i] = Quality::linear;
+			memset(phases, 0, polyphony * sizeof(T));
+			memset(steps, 0, polyphony * sizeof(T));
+		}
+
+		// grains faster than unit speed read from a prefiltered octave of the source
+		Granulator(Wave<T>* window, Mipmap<T, B>* mipmap) : Granulator(window, mipmap->get_source())
+		{
+			this->mipmap = mipmap;
+		}
+
+		// snap subsequent grain onsets to landmarks of the source (mode is free, crossings, or onsets)
+		void snap(Landmarks<T>* index, int mode = crossings)
+		{
+			this->index = index;
+			snapping = index ? mode : free;
+			if (index)
+				index->limit(size);
+		}
+
+		// draw grain windows from a family of shapes (instead of the single window), chosen per grain
+		void shapes(Windows<T>* family)
+		{
+			this->family = family;
+		}
+
+		// interpolation used by subsequently requested grains (trades CPU for fidelity per voice)
+		void quality(Quality tier)
+		{
+			this->tier = tier;
+		}
+
+		// loop the source's most recent material (fade in seconds at the seam) while grains keep playing,
+		// or resume recording. voices in flight carry on from where they were
+		void freeze(T fade = 0.05)
+		{
+			if (drift == 0)
+				return;
+
+			if (mipmap)
+				mipmap->freeze(SR * fade);
+			else
+				source->freeze(SR * fade);
+
+			drift = 0; // the source no longer moves away from the grains
+			for (size_t i = 0; i < polyphony; i++)
+				offsets[i] += ticks[i];
+		}
+
+		void thaw()
+		{
+			if (drift == 1)
+				return;
+
+			if (mipmap)
+				mipmap->thaw();
+			else
+				source->thaw();
+
+			drift = 1;
+			for (size_t i = 0; i < polyphony; i++)
+				offsets[i] -= ticks[i];
 		}
 
 		// request a grain; return voice number
-		int request(T offset, T size, T speed, T gain, T pan)
+		int request(T offset, T size, T speed, T gain, T pan, T shape = 0)
 		{
 			if (size == 0)
 				return -1;
 			
-			offset = std::max(offset, size * (speed - 1)); // keep things causal
+			size_t level = mipmap ? Mipmap<T, B>::level(speed) : 0;
+			T lookahead = ahead<T>(tier) << level; // newest samples the kernel reads, at the source rate
+			T margin = Mipmap<T, B>::latency(level) + (taps<T>(tier) << level); // samples the kernel reads around a position
+			T earliest = std::max<T>(size * (speed - 1), 0) + (Mipmap<T, B>::latency(level) + lookahead) / SR;
+			T latest = ((T)this->size - margin) / SR - std::max<T>(size * (1 - speed), 0);
+			latest = std::max(latest, earliest); // causality wins if the source is too short for both
+			offset = std::clamp(offset, earliest, latest); // keep things causal, and inside the source
+
+			// onsets move by at most a small fraction of the grain, so position jitter survives snapping
+			T reach = SR * std::min<T>(0.005, size / 8);
+			if (snapping == crossings)
+				offset = index->crossing(SR * offset, SR * earliest, reach) / SR;
+			else if (snapping == onsets)
+				offset = index->onset(SR * offset, SR * earliest, reach) / SR;
+			offset = std::clamp(offset, earliest, latest); // snapping may not leave either bound
+
 			int voice = -1;
 			for (size_t i = 0; i < polyphony; i++) // inefficient: looks for first vacant voice
 				if (!active[i])
@@ -48,6 +137,12 @@ namespace soundmath
 				sizes[voice] = SR * size; // size in samples
 				speeds[voice] = speed; // playback speed (negative numbers permitted)
 				gains[voice] = gain;
+				levels[voice] = level;
+				qualities[voice] = tier;
+				if (family)
+					selections[voice] = family->select(shape); // resolved once per grain
+				phases[voice] = 0;
+				steps[voice] = 1 / sizes[voice];
 				// pans[voice] = pan; // not in use
 				active[voice] = true;
 				activity++;
@@ -62,7 +157,10 @@ namespace soundmath
 		{
 			for (size_t i = 0; i < polyphony; i++)
 				if (active[i])
+				{
 					ticks[i]++;
+					phases[i] += steps[i];
+				}
 		}
 
 		T operator()()
@@ -71,8 +169,14 @@ namespace soundmath
 			for (size_t i = 0; i < polyphony; i++) // somewhat inefficient
 				if (active[i])
 				{
-					T phase = (T)ticks[i] / sizes[i];
-					out += gains[i] * (*source)(offsets[i] + (1 - speeds[i]) * ticks[i]) * (*window)(phase);
+					T position = offsets[i] + (drift - speeds[i]) * ticks[i];
+					T sample;
+					if (qualities[i] == Quality::linear)
+						sample = levels[i] ? (*mipmap)(levels[i], position) : (*source)(position);
+					else
+						sample = levels[i] ? (*mipmap)(levels[i], position, qualities[i]) : (*source)(position, qualities[i]);
+					T envelope = family ? Windows<T>::lookup(selections[i], phases[i]) : (*window)(phases[i]);
+					out += gains[i] * sample * envelope;
 					if (ticks[i] >= sizes[i])
 					{
 						active[i] = false;
@@ -93,7 +197,13 @@ namespace soundmath
 
 	private:
 		Wave<T>* window;
-		Buffer<T>* source;
+		Windows<T>* family = nullptr;
+		B* source;
+		Mipmap<T, B>* mipmap = nullptr;
+		Landmarks<T>* index = nullptr;
+		int snapping = free;
+		Quality tier = Quality::linear;
+		T drift = 1; // samples the source advances per tick (0 while frozen)
 		size_t size;
 
 		size_t ticks[polyphony];
@@ -102,6 +212,11 @@ namespace soundmath
 		T speeds[polyphony];
 		T gains[polyphony];
 		// T pans[polyphony];
+		size_t levels[polyphony]; // mipmap level read by each voice
+		Quality qualities[polyphony]; // interpolation used by each voice
+		T phases[polyphony]; // window phases, advanced by steps on each tick
+		T steps[polyphony];
+		typename Windows<T>::Selection selections[polyphony];
 
 		bool active[polyphony];
 	};
@@ -139,10 +254,31 @@ namespace soundmath
 		void tick()
 		{
 			timekeeper->tick();
+			countdown -= (countdown > 0);
+		}
+
+		// pitch-synchronous mode: grains are two periods long, centered on the source's pitch marks,
+		// and emitted every period / |speed| samples (pass nullptr to return to the free-running metro)
+		void follow(Pitchmarker<T>* marker)
+		{
+			this->marker = marker;
+			countdown = 0;
+		}
+
+		// reseed the grain randomizer (for reproducible renders)
+		void seed(uint32_t seed)
+		{
+			randomizer->seed(seed);
 		}
 
-		bool parameters(T* the_offset, T* the_size, T* the_speed, T* the_gain, T* the_pan)
+		bool parameters(T* the_offset, T* the_size, T* the_speed, T* the_gain, T* the_pan, T* the_shape = nullptr)
 		{
+			if (the_shape)
+				*the_shape = params[shape];
+
+			if (marker && marker->voiced())
+				return synchronous(the_offset, the_size, the_speed, the_gain, the_pan);
+
 			if ((*timekeeper)() && (1 + (*randomizer)() > 2 * params[spray]))
 			{
 				*the_offset = 0.5 * (1.0 + (*randomizer)()) * params[jitter];
@@ -169,6 +305,27 @@ namespace soundmath
 
 		Noise<T>* randomizer;
 		Metro<T>* timekeeper;
+
+		Pitchmarker<T>* marker = nullptr;
+		T countdown = 0; // samples until the next pitch-synchronous grain
+
+		bool synchronous(T* the_offset, T* the_size, T* the_speed, T* the_gain, T* the_pan)
+		{
+			T ratio = std::abs(params[speed]);
+			if (countdown > 0 || ratio == 0 || params[density] == 0)
+				return false;
+
+			T period = marker->period();
+			countdown += period / ratio;
+
+			*the_offset = (marker->latest() + period) / SR; // start one period before the mark
+			*the_size = 2 * period / SR;
+			*the_speed = 1; // transposition comes from the grain rate, not from resampling
+			*the_gain = params[gain] / std::max(ratio, (T)1); // hann windows overlap-add to the ratio
+			*the_pan = params[pan];
+
+			return true;
+		}
 	};
 
 }
@@ -0,0 +1,100 @@
+// halfband.h
+#ifndef HALFBAND
+
+#include "globals.h"
+
+namespace soundmath
+{
+	// linear-phase half-band lowpass (windowed sinc) for decimation and interpolation by 2.
+	// every other tap is zero except the center, so each output costs `half` multiply-adds per phase.
+	// length is 4 * half - 1 taps; group delay is 2 * half - 1 samples at the higher rate
+	template <typename T, size_t half = 3> class Halfband
+	{
+	public:
+		static const size_t length = 4 * half - 1;
+		static const size_t delay = 2 * half - 1;
+
+		Halfband()
+		{
+			// odd taps of 0.5 * sinc(n / 2), Blackman-windowed
+			T sum = 0;
+			for (size_t j = 0; j < half; j++)
+			{
+				T n = 2 * j + 1;
+				T w = 0.42 + 0.5 * cos(PI * n / (delay + 1)) + 0.08 * cos(2 * PI * n / (delay + 1));
+				coeffs[j] = w * sin(PI * n / 2) / (PI * n);
+				sum += 2 * coeffs[j];
+			}
+
+			// normalize for unity gain at DC
+			for (size_t j = 0; j < half; j++)
+				coeffs[j] *= 0.5 / sum;
+
+			forget();
+		}
+
+		~Halfband() { }
+
+		void forget()
+		{
+			memset(history, 0, 2 * length * sizeof(T));
+			origin = 0;
+			phase = false;
+		}
+
+		// feed one sample at the higher rate; every other call produces a lowpassed sample at half rate
+		bool decimate(T sample, T* out)
+		{
+			push(sample);
+			phase = !phase;
+			if (phase)
+				return false;
+
+			*out = filter();
+			return true;
+		}
+
+		// feed one sample at the lower rate; writes two samples at the higher rate
+		void interpolate(T sample, T* out)
+		{
+			// polyphase form of zero-stuffing followed by the filter (with gain 2)
+			push(sample);
+			T* x = history + origin;
+
+			T odd = 0;
+			for (size_t j = 0; j < half; j++)
+				odd += coeffs[j] * (x[half - 1 - j] + x[half + j]);
+
+			out[0] = x[half];
+			out[1] = 2 * odd;
+		}
+
+	private:
+		T coeffs[half]; // taps at offsets +-1, +-3, ..., +-(2 * half - 1) from center
+		T history[2 * length]; // mirrored ring: history[origin, origin + length) is always contiguous
+		size_t origin;
+		bool phase;
+
+		inline void push(T sample)
+		{
+			origin = (origin + length - 1) % length;
+			history[origin] = sample;
+			history[origin + length] = sample;
+		}
+
+		// filter output centered on the sample `delay` samples ago
+		inline T filter()
+		{
+			T* x = history + origin; // x[k] is the sample k steps ago
+
+			T out = 0.5 * x[delay];
+			for (size_t j = 0; j < half; j++)
+				out += coeffs[j] * (x[delay - (2 * j + 1)] + x[delay + (2 * j + 1)]);
+
+			return out;
+		}
+	};
+}
+
+#define HALFBAND
+#endif
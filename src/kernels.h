@@ -0,0 +1,155 @@
+// kernels.h
+#ifndef KERNELS
+
+#include "globals.h"
+
+namespace soundmath
+{
+	// interpolation kernels, cheapest first
+	enum class Quality { linear, hermite, lagrange, sinc };
+
+	// each kernel reads taps consecutive samples x[0, taps) in time order (oldest first) and
+	// evaluates at t in [0, 1], measured from x[before] towards x[before + 1]
+	template <typename T> struct Linear
+	{
+		static const int taps = 2;
+		static const int before = 0;
+
+		static inline T eval(const T* x, T t)
+		{
+			return x[0] + t * (x[1] - x[0]);
+		}
+	};
+
+	// 4-point, 3rd-order Hermite (Catmull-Rom)
+	template <typename T> struct Hermite
+	{
+		static const int taps = 4;
+		static const int before = 1;
+
+		static inline T eval(const T* x, T t)
+		{
+			T c1 = 0.5 * (x[2] - x[0]);
+			T c2 = x[0] - 2.5 * x[1] + 2 * x[2] - 0.5 * x[3];
+			T c3 = 0.5 * (x[3] - x[0]) + 1.5 * (x[1] - x[2]);
+			return ((c3 * t + c2) * t + c1) * t + x[1];
+		}
+	};
+
+	// 6-point, 5th-order Lagrange
+	template <typename T> struct Lagrange
+	{
+		static const int taps = 6;
+		static const int before = 2;
+
+		static inline T eval(const T* x, T t)
+		{
+			// distances from each node (nodes at -2, ..., 3)
+			T d0 = t + 2, d1 = t + 1, d2 = t, d3 = t - 1, d4 = t - 2, d5 = t - 3;
+			T d01 = d0 * d1, d45 = d4 * d5;
+			T d23 = d2 * d3;
+
+			return - x[0] * (d1 * d23 * d45) / 120
+				   + x[1] * (d0 * d23 * d45) / 24
+				   - x[2] * (d01 * d3 * d45) / 12
+				   + x[3] * (d01 * d2 * d45) / 12
+				   - x[4] * (d01 * d23 * d5) / 24
+				   + x[5] * (d01 * d23 * d4) / 120;
+		}
+	};
+
+	// 8-point windowed sinc, from a polyphase table (phases linearly interpolated)
+	template <typename T> struct Sinc
+	{
+		static const int taps = 8;
+		static const int before = 3;
+		static const int phases = 256;
+
+		static inline T eval(const T* x, T t)
+		{
+			T position = t * phases;
+			int phase = std::min((int)position, phases - 1);
+			T disp = position - phase;
+
+			const T* lower = table.coeffs[phase];
+			const T* upper = table.coeffs[phase + 1];
+
+			T out = 0;
+			for (int k = 0; k < taps; k++)
+				out += x[k] * (lower[k] + disp * (upper[k] - lower[k]));
+			return out;
+		}
+
+		static const Sinc table; // built with the program's statics, not on first use in the callback
+
+		T coeffs[phases + 1][taps];
+
+		Sinc()
+		{
+			for (int p = 0; p <= phases; p++)
+			{
+				T t = (T)p / phases;
+				T sum = 0;
+				for (int k = 0; k < taps; k++)
+				{
+					T x = k - before - t; // distance from the evaluation point
+					T w = (x + taps / 2) / taps; // blackman window over [-taps/2, taps/2]
+					T window = 0.42 - 0.5 * cos(2 * PI * w) + 0.08 * cos(4 * PI * w);
+					T sinc = (x == 0) ? 1 : sin(PI * x) / (PI * x);
+					coeffs[p][k] = window * sinc;
+					sum += coeffs[p][k];
+				}
+
+				for (int k = 0; k < taps; k++) // unity gain at DC
+					coeffs[p][k] /= sum;
+			}
+		}
+	};
+
+	template <typename T> const Sinc<T> Sinc<T>::table;
+
+	// largest kernel footprint (buffers keep this many samples readable without wrapping)
+	const int max_taps = 8;
+
+	template <typename T> inline int taps(Quality quality)
+	{
+		switch (quality)
+		{
+			case Quality::hermite: return Hermite<T>::taps;
+			case Quality::lagrange: return Lagrange<T>::taps;
+			case Quality::sinc: return Sinc<T>::taps;
+			default: return Linear<T>::taps;
+		}
+	}
+
+	template <typename T> inline int before(Quality quality)
+	{
+		switch (quality)
+		{
+			case Quality::hermite: return Hermite<T>::before;
+			case Quality::lagrange: return Lagrange<T>::before;
+			case Quality::sinc: return Sinc<T>::before;
+			default: return Linear<T>::before;
+		}
+	}
+
+	// how far ahead of position a kernel reads: positions >= ahead never touch the write slot (delay 0)
+	template <typename T> inline int ahead(Quality quality)
+	{
+		return taps<T>(quality) - before<T>(quality) - 1;
+	}
+
+	template <typename T> inline T interpolate(Quality quality, const T* x, T t)
+	{
+		switch (quality)
+		{
+			case Quality::hermite: return Hermite<T>::eval(x, t);
+			case Quality::lagrange: return Lagrange<T>::eval(x, t);
+			case Quality::sinc: return Sinc<T>::eval(x, t);
+			default: return Linear<T>::eval(x, t);
+		}
+	}
+}
+
+#define KERNELS
+#endif
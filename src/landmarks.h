@@ -0,0 +1,177 @@
+// landmarks.h
+#ifndef LANDMARKS
+
+#include "globals.h"
+#include <cstdint>
+
+namespace soundmath
+{
+	// incremental index of zero crossings and onsets, kept alongside a recording buffer.
+	// positions are stored as absolute sample times in rings (oldest first), so the nearest
+	// landmark to any delay is found by binary search. crossings count only once the signal has
+	// swung below -floor (about -50 dB) or a tenth of its level, so noise doesn't fill the ring;
+	// once limit() is given the buffer's length, crossings are thinned so the ring spans all of it
+	template <typename T, size_t capacity = 8192> class Landmarks
+	{
+		static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+		static const size_t sparse = capacity / 8; // onsets are already spaced by the refractory time
+
+	public:
+		// threshold is the ratio of fast to slow envelope that counts as an attack
+		Landmarks(T threshold = 3, T refractory = 0.05, T floor = 0.003) :
+			threshold(threshold), refractory(refractory * SR), floor(floor)
+		{
+			fast_attack = exp(-1.0 / (0.001 * SR));
+			fast_release = exp(-1.0 / (0.02 * SR));
+			slow = exp(-1.0 / (0.1 * SR));
+		}
+
+		~Landmarks() { }
+
+		// forget landmarks older than this many samples (the length of the buffer they index), and
+		// keep crossings at least horizon / capacity apart so the ring reaches back that far
+		void limit(size_t horizon)
+		{
+			this->horizon = horizon;
+			spacing = std::max<size_t>(1, (horizon + capacity - 1) / capacity);
+		}
+
+		// analyze the current sample; call before tick()
+		void write(T sample)
+		{
+			expire(crossings, capacity, crossing_head, crossing_count);
+			expire(onsets, sparse, onset_head, onset_count);
+
+			// upward crossing, after a swing clear of the noise
+			if (sample < -std::max(floor, (T)0.1 * slower))
+				armed = true;
+			else if (sample >= 0 && armed)
+			{
+				armed = false;
+				if (now - last_crossing >= spacing)
+				{
+					push(crossings, capacity, crossing_head, crossing_count, now);
+					last_crossing = now;
+				}
+			}
+
+			T level = std::abs(sample);
+			T k = level > fast ? fast_attack : fast_release;
+			fast = k * fast + (1 - k) * level;
+			slower = slow * slower + (1 - slow) * level;
+
+			// an onset is where the fast envelope first rises well above the slow one
+			T strength = fast / (slower + 0.0001);
+			bool rising = strength > threshold && !attacking;
+			attacking = strength > (attacking ? 0.6 * threshold : threshold); // hysteresis
+
+			if (rising && now - last_onset > refractory)
+			{
+				strengths[onset_head & (sparse - 1)] = strength;
+				push(onsets, sparse, onset_head, onset_count, now);
+				last_onset = now;
+			}
+		}
+
+		void tick()
+		{
+			now++;
+		}
+
+		// delay (in samples) of the zero crossing nearest the given delay, no more recent than `minimum`
+		// and no more than `reach` samples away; returns the delay unchanged if there is none
+		T crossing(T delay, T minimum = 0, T reach = 0.005 * SR)
+		{
+			return nearest(crossings, capacity, crossing_head, crossing_count, delay, minimum, reach, nullptr);
+		}
+
+		// as crossing(), but for onsets; optionally reports the onset's strength
+		T onset(T delay, T minimum = 0, T reach = 0.005 * SR, T* strength = nullptr)
+		{
+			return nearest(onsets, sparse, onset_head, onset_count, delay, minimum, reach, strength);
+		}
+
+	private:
+		T threshold;
+		T refractory;
+		T floor;
+		T fast_attack, fast_release, slow;
+
+		T fast = 0, slower = 0;
+		bool attacking = false;
+		bool armed = false; // the signal has gone clearly negative since the last crossing
+
+		uint32_t now = 0;
+		uint32_t last_onset = 0;
+		uint32_t last_crossing = 0;
+		size_t horizon = (size_t)-1;
+		size_t spacing = 1; // minimum samples between recorded crossings
+
+		uint32_t crossings[capacity];
+		size_t crossing_head = 0, crossing_count = 0;
+
+		uint32_t onsets[sparse];
+		T strengths[sparse];
+		size_t onset_head = 0, onset_count = 0;
+
+		// rings are power-of-two sized, and indexed by head & (size - 1)
+		static void push(uint32_t* ring, size_t size, size_t& head, size_t& count, uint32_t time)
+		{
+			ring[head & (size - 1)] = time;
+			head++;
+			count += (count < size);
+		}
+
+		// drop entries that have aged out of the indexed buffer (at most a few per sample)
+		void expire(uint32_t* ring, size_t size, size_t head, size_t& count)
+		{
+			while (count > 0 && (uint32_t)(now - ring[(head - count) & (size - 1)]) > horizon)
+				count--;
+		}
+
+		T nearest(uint32_t* ring, size_t size, size_t head, size_t count, T delay, T minimum, T reach, T* strength)
+		{
+			size_t mask = size - 1;
+			if (count == 0 || delay < minimum)
+				return delay;
+
+			// times are compared as ages, which stay monotonic across counter wraparound
+			T target = delay;
+			size_t first = head - count; // oldest entry
+
+			// find the first entry (oldest to newest) younger than the target
+			size_t low = 0, high = count;
+			while (low < high)
+			{
+				size_t middle = (low + high) / 2;
+				if ((T)(uint32_t)(now - ring[(first + middle) & mask]) > target)
+					low = middle + 1;
+				else
+					high = middle;
+			}
+
+			// candidates straddle the target; discard any that are too recent
+			T best = delay;
+			T distance = -1;
+			for (size_t i = (low > 0 ? low - 1 : 0); i < std::min(low + 1, count); i++)
+			{
+				T age = (uint32_t)(now - ring[(first + i) & mask]);
+				if (age < minimum || age > horizon || std::abs(age - target) > reach)
+					continue;
+
+				if (distance < 0 || std::abs(age - target) < distance)
+				{
+					distance = std::abs(age - target);
+					best = age;
+					if (strength)
+						*strength = strengths[(first + i) & mask];
+				}
+			}
+
+			return best;
+		}
+	};
+}
+
+#define LANDMARKS
+#endif
@@ -0,0 +1,230 @@
+// loudness.h
+#ifndef LOUDNESS
+
+#include "globals.h"
+#include "filter.h"
+#include "halfband.h"
+#include <atomic>
+
+namespace soundmath
+{
+	// loudness meter after ITU-R BS.1770 (mono): K-weighting biquads, momentary (400 ms) and short-term
+	// (3 s) loudness from 100 ms sub-blocks, gated integrated loudness from a histogram of 400 ms
+	// blocks, and 4x oversampled true peak. process() runs in the audio callback; read() may be called
+	// from the main loop at any time and never blocks the writer (sequence lock)
+	template <typename T> class Loudness
+	{
+	public:
+		struct Reading
+		{
+			T momentary; // LUFS
+			T shortterm; // LUFS
+			T integrated; // LUFS
+			T peak; // dBTP, highest since reset()
+		};
+
+		Loudness()
+		{
+			// stage 1: high shelf (head response)
+			T K = tan(PI * 1681.974450955533 / SR);
+			T Q = 0.7071752369554196;
+			T Vh = pow(10, 3.999843853973347 / 20);
+			T Vb = pow(Vh, 0.4996667741545416);
+			T a0 = 1 + K / Q + K * K;
+
+			T shelf_forward[3] = {(Vh + Vb * K / Q + K * K) / a0, 2 * (K * K - Vh) / a0, (Vh - Vb * K / Q + K * K) / a0};
+			T shelf_back[3] = {0, 2 * (K * K - 1) / a0, (1 - K / Q + K * K) / a0};
+			shelf.coefficients(shelf_forward, shelf_back);
+
+			// stage 2: highpass (RLB weighting)
+			K = tan(PI * 38.13547087602444 / SR);
+			Q = 0.5003270373238773;
+			a0 = 1 + K / Q + K * K;
+
+			T highpass_forward[3] = {1, -2, 1};
+			T highpass_back[3] = {0, 2 * (K * K - 1) / a0, (1 - K / Q + K * K) / a0};
+			highpass.coefficients(highpass_forward, highpass_back);
+
+			reset();
+		}
+
+		~Loudness() { }
+
+		// restart integration and the peak hold
+		void reset()
+		{
+			memset(blocks, 0, sizeof(blocks));
+			memset(counts, 0, sizeof(counts));
+			memset(energies, 0, sizeof(energies));
+			accumulated = 0;
+			filled = 0;
+			latest = 0;
+			completed = 0;
+			peak = 0;
+			publish(silence, silence, silence, silence);
+		}
+
+		void process(const T* in, uint n)
+		{
+			T weighted[chunk];
+			while (n > 0)
+			{
+				uint m = std::min(n, std::min(chunk, sub - filled));
+
+				shelf.process(in, weighted, m);
+				highpass.process(weighted, weighted, m);
+
+				for (uint j = 0; j < m; j++)
+					accumulated += weighted[j] * weighted[j];
+
+				for (uint j = 0; j < m; j++)
+				{
+					// both 2x samples go through the same second stage, in order, for 4 points per input
+					T upper[2], samples[4];
+					first.interpolate(in[j], upper);
+					second.interpolate(upper[0], samples);
+					second.interpolate(upper[1], samples + 2);
+					for (size_t i = 0; i < 4; i++)
+						peak = std::max(peak, std::abs(samples[i]));
+				}
+
+				filled += m;
+				if (filled == sub)
+					complete();
+
+				in += m;
+				n -= m;
+			}
+		}
+
+		// latest values (control rate; lock-free)
+		Reading read()
+		{
+			Reading reading;
+			uint32_t before, after;
+			do
+			{
+				before = sequence.load(std::memory_order_acquire);
+				reading.momentary = values[0].load(std::memory_order_relaxed);
+				reading.shortterm = values[1].load(std::memory_order_relaxed);
+				reading.integrated = values[2].load(std::memory_order_relaxed);
+				reading.peak = values[3].load(std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				after = sequence.load(std::memory_order_relaxed);
+			} while ((before & 1) || before != after);
+
+			return reading;
+		}
+
+	private:
+		static constexpr uint chunk = 64;
+		static constexpr uint sub = SR / 10; // 100 ms sub-blocks
+		static const size_t history = 30; // sub-blocks in the short-term window
+		static const size_t bins = 750; // 0.1 LU histogram bins, from -70 LUFS
+		static constexpr T lowest = -70; // absolute gate
+		static constexpr T silence = -120;
+
+		Filter<T, 2> shelf, highpass;
+		Halfband<T, 6> first, second; // 2x, then 2x again
+
+		T blocks[history]; // mean square of recent sub-blocks
+		size_t latest; // index of the newest
+		size_t completed; // sub-blocks since reset(), up to history
+		double accumulated; // sum of squares in the current sub-block
+		uint filled; // samples in the current sub-block
+		T peak;
+
+		uint32_t counts[bins]; // 400 ms blocks per loudness bin
+		double energies[bins]; // and their summed mean squares
+
+		std::atomic<uint32_t> sequence{0};
+		std::atomic<T> values[4];
+
+		static T lufs(double square)
+		{
+			return (square > 0) ? -0.691 + 10 * log10(square) : silence;
+		}
+
+		// a sub-block is done: update the windows, the histogram, and the published reading
+		void complete()
+		{
+			latest = (latest + 1) % history;
+			blocks[latest] = accumulated / sub;
+			accumulated = 0;
+			filled = 0;
+			completed += (completed < history);
+
+			// windows are measured only once they're full, not while they still hold the zeros of reset()
+			T level = silence;
+			if (completed >= 4)
+			{
+				// 400 ms blocks with 75% overlap enter the gated integration
+				double momentary = power(4);
+				level = lufs(momentary);
+				if (level > lowest)
+				{
+					size_t bin = std::min<size_t>((level - lowest) * 10, bins - 1);
+					counts[bin]++;
+					energies[bin] += momentary;
+				}
+			}
+
+			T shortterm = (completed == history) ? lufs(power(history)) : silence;
+			publish(level, shortterm, integrate(), peak > 0 ? 20 * log10(peak) : silence);
+		}
+
+		// mean square of the last count sub-blocks
+		double power(size_t count)
+		{
+			double sum = 0;
+			for (size_t i = 0; i < count; i++)
+				sum += blocks[(latest + history - i) % history];
+			return sum / count;
+		}
+
+		// absolute gate at -70 LUFS, then a relative gate 10 LU below the absolutely gated loudness
+		T integrate()
+		{
+			double energy = 0;
+			uint32_t count = 0;
+			for (size_t b = 0; b < bins; b++)
+			{
+				energy += energies[b];
+				count += counts[b];
+			}
+			if (count == 0)
+				return silence;
+
+			T gate = lufs(energy / count) - 10;
+			size_t start = (gate > lowest) ? std::min<size_t>((gate - lowest) * 10, bins - 1) : 0;
+
+			energy = 0;
+			count = 0;
+			for (size_t b = start; b < bins; b++)
+			{
+				energy += energies[b];
+				count += counts[b];
+			}
+
+			return count ? lufs(energy / count) : silence;
+		}
+
+		// writer side of the sequence lock (the audio callback; never waits)
+		void publish(T momentary, T shortterm, T integrated, T peak)
+		{
+			uint32_t s = sequence.load(std::memory_order_relaxed);
+			sequence.store(s + 1, std::memory_order_relaxed); // odd: writing
+			std::atomic_thread_fence(std::memory_order_release);
+
+			values[0].store(momentary, std::memory_order_relaxed);
+			values[1].store(shortterm, std::memory_order_relaxed);
+			values[2].store(integrated, std::memory_order_relaxed);
+			values[3].store(peak, std::memory_order_relaxed);
+
+			sequence.store(s + 2, std::memory_order_release);
+		}
+	};
+}
+
+#define LOUDNESS
+#endif
@@ -0,0 +1,250 @@
+// mapped.h
+#ifndef MAPPED
+
+#include "globals.h"
+#include "buffer.h"
+
+// memory-mapped files exist only in host builds
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include <type_traits>
+
+namespace soundmath
+{
+	// circular buffer backed by a memory-mapped file (raw samples of type T, or a mono WAV whose
+	// samples are stored as T, e.g. 32-bit float for T = float). pages are loaded on demand, so
+	// opening an hour-long file is immediate and nothing is copied into RAM
+	template <typename T> class MBuffer : public Buffer<T>
+	{
+	public:
+		static const int readonly = 0; // write() and accum() are ignored, tick() moves the playhead
+		static const int writable = 1; // writes go through to the file
+
+		MBuffer()
+		{
+			close();
+		}
+
+		MBuffer(const char* path, int mode = readonly)
+		{
+			close();
+			open(path, mode);
+		}
+
+		~MBuffer()
+		{
+			close();
+			this->data = nullptr; // not ours to delete
+		}
+
+		// map a file; returns false (leaving the buffer closed) if it can't be mapped as samples of type T.
+		// a closed buffer reads as one sample of silence, so it's safe to tick and read regardless
+		bool open(const char* path, int mode = readonly)
+		{
+			close();
+
+			int descriptor = ::open(path, mode == writable ? O_RDWR : O_RDONLY);
+			if (descriptor < 0)
+				return false;
+
+			struct stat info;
+			if (fstat(descriptor, &info) < 0 || info.st_size == 0)
+			{
+				::close(descriptor);
+				return false;
+			}
+
+			length = info.st_size;
+			int protection = PROT_READ | (mode == writable ? PROT_WRITE : 0);
+			void* address = mmap(nullptr, length, protection, MAP_SHARED, descriptor, 0);
+			::close(descriptor); // the mapping keeps the file alive
+
+			if (address == MAP_FAILED)
+				return false;
+
+			base = (uint8_t*)address;
+
+			size_t offset = 0, bytes = length;
+			if (!locate(&offset, &bytes))
+			{
+				close();
+				return false;
+			}
+
+			if (bytes < sizeof(T))
+			{
+				close();
+				return false;
+			}
+
+			this->data = (T*)(base + offset);
+			this->size = bytes / sizeof(T);
+			this->origin = 0;
+			this->mode = mode;
+
+			madvise(base, length, MADV_SEQUENTIAL); // grains mostly move forwards
+			return true;
+		}
+
+		void close()
+		{
+			if (base)
+				munmap(base, length);
+
+			base = nullptr;
+			length = 0;
+			mode = readonly;
+			this->frozen = false;
+
+			silence = 0;
+			this->data = &silence;
+			this->size = 1;
+			this->origin = 0;
+		}
+
+		bool is_open()
+		{
+			return base != nullptr;
+		}
+
+		inline void write(T value)
+		{
+			if (mode == writable && !this->frozen)
+				this->data[this->origin] = value;
+		}
+
+		// write n samples and advance past them; a read-only map just advances
+		void write(const T* values, uint n)
+		{
+			if (mode == writable)
+				return Buffer<T>::write(values, n);
+
+			if (!this->frozen)
+				this->origin = (this->origin + n) % this->size;
+		}
+
+		inline void accum(T value)
+		{
+			if (mode == writable && !this->frozen)
+				this->data[this->origin] += value;
+		}
+
+		// stop the playhead and loop; a read-only map can't take the seam's crossfade, so it
+		// loops the whole file instead (whose ends meet as they do when ticking)
+		void freeze(uint fade)
+		{
+			if (mode == writable)
+				return Buffer<T>::freeze(fade);
+
+			this->length = this->size;
+			this->frozen = true;
+		}
+
+		// hint that the n samples before the given delay will be read soon
+		void prefetch(T position, size_t n)
+		{
+			int end = (int)this->origin - (int)position;
+			end += (end < 0) ? this->size : 0;
+
+			int start = end - (int)n;
+			if (start < 0) // wraps: also fetch the end of the file
+			{
+				advise(start + this->size, this->size);
+				start = 0;
+			}
+			advise(start, end + 1);
+		}
+
+		// set the playhead (e.g. to scrub a read-only file)
+		void seek(uint position)
+		{
+			this->origin = position % this->size;
+		}
+
+		// flush writes to disk (writable mode)
+		void sync()
+		{
+			if (base)
+				msync(base, length, MS_ASYNC);
+		}
+
+	private:
+		uint8_t* base = nullptr; // start of the mapping
+		size_t length = 0; // bytes mapped
+		int mode = readonly;
+		T silence = 0; // stands in for the samples while closed
+
+		void advise(size_t first, size_t last)
+		{
+			static const size_t page = sysconf(_SC_PAGESIZE);
+
+			if (!base)
+				return;
+
+			uintptr_t from = (uintptr_t)(this->data + first) & ~(page - 1);
+			uintptr_t to = (uintptr_t)(this->data + std::min<size_t>(last, this->size));
+			if (to > from)
+				madvise((void*)from, to - from, MADV_WILLNEED);
+		}
+
+		static uint32_t word(const uint8_t* p)
+		{
+			return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+		}
+
+		static uint16_t half(const uint8_t* p)
+		{
+			return p[0] | (p[1] << 8);
+		}
+
+		// find the samples: the data chunk of a WAV file, or the whole file if raw
+		bool locate(size_t* offset, size_t* bytes)
+		{
+			if (length < 12 || memcmp(base, "RIFF", 4) || memcmp(base + 8, "WAVE", 4))
+				return length % sizeof(T) == 0; // raw
+
+			bool formatted = false;
+			size_t position = 12;
+			while (position + 8 <= length)
+			{
+				const uint8_t* chunk = base + position;
+				size_t chunksize = word(chunk + 4);
+
+				if (!memcmp(chunk, "fmt ", 4) && chunksize >= 16 && position + 8 + chunksize <= length)
+				{
+					uint16_t format = half(chunk + 8);
+					uint16_t channels = half(chunk + 10);
+					uint16_t bits = half(chunk + 22);
+
+					// extensible: the actual format is the first two bytes of the SubFormat GUID
+					if (format == 0xfffe)
+						format = (chunksize >= 40) ? half(chunk + 32) : 0;
+
+					bool known = (format == 1 || format == 3); // PCM or IEEE float
+					bool floating = (format == 3);
+					formatted = (known && channels == 1 && bits == 8 * sizeof(T) && floating == !std::is_integral<T>::value);
+				}
+				else if (!memcmp(chunk, "data", 4))
+				{
+					*offset = position + 8;
+					*bytes = std::min(chunksize, length - *offset);
+					return formatted && (*offset % alignof(T) == 0);
+				}
+
+				position += 8 + chunksize + (chunksize & 1);
+			}
+
+			return false;
+		}
+	};
+}
+
+#endif
+
+#define MAPPED
+#endif
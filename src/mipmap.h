@@ -0,0 +1,150 @@
+// mipmap.h
+#ifndef MIPMAP
+
+#include "globals.h"
+#include "buffer.h"
+#include "halfband.h"
+
+namespace soundmath
+{
+	// octave mipmaps of a recording buffer: level k holds the source lowpassed and decimated by 2^k,
+	// updated incrementally as samples are written. reading a level at speed s <= 2^k cannot alias.
+	// levels are stored in the source's format (B::codec), so compressed recordings stay compressed
+	template <typename T, typename B = Buffer<T>, size_t levels = 2> class Mipmap
+	{
+		typedef PBuffer<T, typename B::codec> Level;
+		typedef typename B::codec::type U; // storage type
+
+	public:
+		// total samples (of the source's storage type) needed for the decimated copies of a source of given size
+		static constexpr size_t footprint(size_t size)
+		{
+			size_t total = 0;
+			for (size_t k = 1; k <= levels; k++)
+				total += Level::footprint(size >> k);
+			return total;
+		}
+
+		// memory (if given) must hold footprint(source->get_size()) samples
+		Mipmap(B* source, U* memory = nullptr) : source(source)
+		{
+			size_t size = source->get_size();
+			for (size_t k = 1; k <= levels; k++)
+			{
+				if (memory)
+				{
+					copies[k] = new Level(memory, size >> k);
+					memory += Level::footprint(size >> k);
+				}
+				else
+					copies[k] = new Level(size >> k);
+
+				since[k] = 0;
+			}
+		}
+
+		~Mipmap()
+		{
+			for (size_t k = 1; k <= levels; k++)
+				delete copies[k];
+		}
+
+		// write to the source and propagate down the levels (amortized cost: one halfband output per sample)
+		void write(T sample)
+		{
+			if (frozen)
+				return;
+
+			source->write(sample);
+
+			T value = sample;
+			for (size_t k = 0; k < levels; k++)
+			{
+				if (!filters[k].decimate(value, &value))
+					break;
+
+				copies[k + 1]->tick();
+				copies[k + 1]->write(value);
+				since[k + 1] = 0;
+			}
+		}
+
+		void tick()
+		{
+			if (frozen)
+				return;
+
+			source->tick();
+			for (size_t k = 1; k <= levels; k++)
+				since[k]++;
+		}
+
+		// loop the source and every level (see Buffer::freeze); fade is in source samples
+		void freeze(uint fade)
+		{
+			source->freeze(fade);
+			for (size_t k = 1; k <= levels; k++)
+				copies[k]->freeze(fade >> k);
+			frozen = true;
+		}
+
+		void thaw()
+		{
+			source->thaw();
+			for (size_t k = 1; k <= levels; k++)
+				copies[k]->thaw();
+			frozen = false;
+		}
+
+		// lowest level that can be read at the given speed without aliasing
+		static size_t level(T speed)
+		{
+			speed = std::abs(speed);
+			size_t k = 0;
+			while (k < levels && speed > (T)(1 << k))
+				k++;
+			return k;
+		}
+
+		// samples of delay (at the source rate) introduced by the decimation filters of level k
+		static T latency(size_t k)
+		{
+			return (T)(Halfband<T>::delay * ((1 << k) - 1));
+		}
+
+		// linear-interpolated lookup into the past of level k, with delay in source samples
+		inline T operator()(size_t k, T position)
+		{
+			if (k == 0)
+				return (*source)(position);
+
+			position = (position - latency(k) - since[k]) / (1 << k);
+			return (*copies[k])(frozen ? position : std::max(position, (T)0));
+		}
+
+		// as above, with a selectable interpolation kernel
+		inline T operator()(size_t k, T position, Quality quality)
+		{
+			if (k == 0)
+				return (*source)(position, quality);
+
+			position = (position - latency(k) - since[k]) / (1 << k);
+			return (*copies[k])(frozen ? position : std::max(position, (T)ahead<T>(quality)), quality);
+		}
+
+		B* get_source()
+		{
+			return source;
+		}
+
+	private:
+		B* source;
+		Level* copies[levels + 1]; // copies[0] is unused (the source itself)
+		Halfband<T> filters[levels];
+		size_t since[levels + 1]; // source samples since level k was last written
+		bool frozen = false;
+	};
+}
+
+#define MIPMAP
+#endif
@@ -0,0 +1,207 @@
+// modal.h
+#ifndef MODAL
+
+#include "globals.h"
+#include "rng.h"
+
+namespace soundmath
+{
+	// modal synthesis: many two-pole resonators (as Filter::resonant, with the pole radius set by a
+	// decay time) excited by an input or by noise bursts. modes are stored structure-of-arrays and
+	// run in groups of 8; a group whose modes have all decayed is skipped until an excitation strong
+	// enough to lift it above the threshold arrives (so input noise alone doesn't wake it)
+	template <typename T, size_t modes = 128> class Modal
+	{
+		static_assert(modes % 8 == 0, "modes run in groups of 8");
+
+	public:
+		Modal(uint32_t seed = Random<T>::stream()) : generator(seed)
+		{
+			memset(feedback1, 0, sizeof(feedback1));
+			memset(feedback2, 0, sizeof(feedback2));
+			memset(inputs, 0, sizeof(inputs));
+			memset(previous, 0, sizeof(previous));
+			memset(current, 0, sizeof(current));
+			memset(active, false, sizeof(active));
+			memset(reach, 0, sizeof(reach));
+		}
+
+		~Modal() { }
+
+		// mode i rings at frequency (Hz) for decay seconds (to -60 dB), with the given amplitude
+		void mode(size_t i, T frequency, T decay, T gain)
+		{
+			T theta = 2 * PI * std::clamp<T>(frequency, 0, 0.49 * SR) / SR;
+			T radius = (decay > 0) ? pow(10, -3 / (decay * SR)) : 0;
+
+			feedback1[i] = 2 * radius * cos(theta);
+			feedback2[i] = -radius * radius;
+			inputs[i] = gain * sin(theta); // unit amplitude impulse response, times gain
+
+			size_t g = i / lanes;
+			reach[g] = 0;
+			for (size_t w = 0; w < lanes; w++)
+				reach[g] = std::max(reach[g], std::abs(inputs[g * lanes + w]));
+		}
+
+		// load count modes from tables (the rest are silenced, and their groups never run)
+		void load(const T* frequencies, const T* decays, const T* gains, size_t count)
+		{
+			for (size_t i = 0; i < modes; i++)
+			{
+				if (i < count)
+					mode(i, frequencies[i], decays[i], gains[i]);
+				else
+					mode(i, 0, 0, 0);
+			}
+		}
+
+		// excite every mode with a noise burst of given amplitude and length (seconds)
+		void strike(T velocity, T length = 0.005)
+		{
+			burst = velocity;
+			remaining = length * SR;
+			fade = velocity / std::max<T>(remaining, 1);
+		}
+
+		// modes below this amplitude are considered silent
+		void threshold(T value)
+		{
+			floor = value;
+		}
+
+		// one sample: the input (may be zero) plus any burst excites the modes
+		T operator()(T sample)
+		{
+			if (!computed)
+			{
+				out = 0;
+				process(&sample, &out, 1);
+				computed = true;
+			}
+
+			return out;
+		}
+
+		void tick()
+		{
+			computed = false;
+		}
+
+		// n samples; in may be nullptr (bursts only)
+		void process(const T* in, T* out, uint n)
+		{
+			while (n > 0)
+			{
+				uint m = std::min(n, chunk);
+				span(in, out, m);
+
+				if (in)
+					in += m;
+				out += m;
+				n -= m;
+			}
+		}
+
+		// number of groups of 8 modes still ringing
+		size_t ringing()
+		{
+			size_t count = 0;
+			for (size_t g = 0; g < groups; g++)
+				count += active[g];
+			return count;
+		}
+
+	private:
+		static constexpr uint chunk = 64;
+		static const size_t lanes = 8;
+		static const size_t groups = modes / lanes;
+
+		T feedback1[modes], feedback2[modes], inputs[modes];
+		T previous[modes], current[modes]; // y[n - 2], y[n - 1]
+		bool active[groups];
+		T reach[groups]; // largest input gain in each group
+
+		Random<T> generator;
+		T burst = 0;
+		T fade = 0;
+		T remaining = 0; // samples of burst left
+		T floor = 1e-5;
+
+		T out = 0;
+		bool computed = false;
+
+		void span(const T* in, T* out, uint m)
+		{
+			T excitation[chunk];
+			if (in)
+				memcpy(excitation, in, m * sizeof(T));
+			else
+				memset(excitation, 0, m * sizeof(T));
+
+			if (remaining > 0)
+			{
+				T noise[chunk];
+				generator.uniform(noise, m, -1, 1);
+				for (uint j = 0; j < m && remaining > 0; j++, remaining--)
+				{
+					excitation[j] += burst * noise[j];
+					burst -= fade;
+				}
+			}
+
+			T loudest = 0;
+			for (uint j = 0; j < m; j++)
+				loudest = std::max(loudest, std::abs(excitation[j]));
+
+			memset(out, 0, m * sizeof(T));
+
+			for (size_t g = 0; g < groups; g++)
+			{
+				if (!active[g] && loudest * reach[g] <= floor) // too weak to be heard (or all gains zero)
+					continue;
+
+				size_t base = g * lanes;
+				T a1[lanes], a2[lanes], b[lanes], y1[lanes], y2[lanes];
+				for (size_t w = 0; w < lanes; w++)
+				{
+					a1[w] = feedback1[base + w];
+					a2[w] = feedback2[base + w];
+					b[w] = inputs[base + w];
+					y1[w] = current[base + w];
+					y2[w] = previous[base + w];
+				}
+
+				for (uint j = 0; j < m; j++)
+				{
+					T x = excitation[j];
+					T sum = 0;
+					for (size_t w = 0; w < lanes; w++)
+					{
+						T y = a1[w] * y1[w] + a2[w] * y2[w] + b[w] * x;
+						y2[w] = y1[w];
+						y1[w] = y;
+						sum += y;
+					}
+					out[j] += sum;
+				}
+
+				T level = 0;
+				for (size_t w = 0; w < lanes; w++)
+				{
+					current[base + w] = y1[w];
+					previous[base + w] = y2[w];
+					level = std::max(level, std::abs(y1[w]) + std::abs(y2[w]));
+				}
+
+				active[g] = level > floor;
+				if (!active[g]) // let the group restart from rest
+					for (size_t w = 0; w < lanes; w++)
+						current[base + w] = previous[base + w] = 0;
+			}
+		}
+	};
+}
+
+#define MODAL
+#endif
@@ -0,0 +1,156 @@
+// modulated.h
+#ifndef MODULATED
+
+#include "globals.h"
+#include "buffer.h"
+
+namespace soundmath
+{
+	// fractional delay line read by several modulated voices (chorus, flanger, vibrato). each voice's
+	// delay time glides towards its target through a one-pole smoother, updated every sample
+	template <typename T, size_t voices = 1> class Modulated
+	{
+	public:
+		static const int linear = 0;
+		static const int allpass = 1; // flat magnitude response; best for slowly moving delays
+		static const int hermite = 2;
+
+		Modulated() { }
+		~Modulated() { }
+
+		// longest delay in samples; smoothing time constant in seconds
+		Modulated(uint time, T smoothing = 0.01, int mode = linear) : buffer(time + chunk + max_taps), longest(time)
+		{
+			this->mode = mode;
+			coefficient = 1 - exp(-1 / (SR * smoothing));
+
+			for (size_t i = 0; i < voices; i++)
+			{
+				targets[i] = times[i] = 1;
+				gains[i] = 1;
+				previous[i] = current[i] = 0;
+			}
+		}
+
+		void interpolation(int mode)
+		{
+			this->mode = mode;
+		}
+
+		// set the delay (in samples, not less than one) that a voice glides towards, and its gain in the mix
+		void set(size_t voice, T time, T gain = 1)
+		{
+			targets[voice] = std::clamp<T>(time, 1, longest);
+			gains[voice] = gain;
+		}
+
+		// jump to the target delays (e.g. after reconfiguring)
+		void settle()
+		{
+			for (size_t i = 0; i < voices; i++)
+				times[i] = targets[i];
+		}
+
+		void write(T sample)
+		{
+			buffer.write(sample);
+		}
+
+		// output of one voice for the sample just written
+		T operator()(size_t voice)
+		{
+			current[voice] = read(times[voice], previous[voice]);
+			return current[voice];
+		}
+
+		// mix of all voices, weighted by their gains
+		T operator()()
+		{
+			T out = 0;
+			for (size_t i = 0; i < voices; i++)
+				out += gains[i] * (*this)(i);
+			return out;
+		}
+
+		void tick()
+		{
+			buffer.tick();
+			for (size_t i = 0; i < voices; i++)
+			{
+				times[i] += coefficient * (targets[i] - times[i]);
+				previous[i] = current[i];
+			}
+		}
+
+		// mix of all voices for n samples (equivalent to n calls of write(), operator()() and tick()).
+		// the input is written once per span, then each voice sweeps the span with its state in locals
+		void process(const T* in, T* out, uint n)
+		{
+			while (n > 0)
+			{
+				uint m = std::min(n, chunk);
+
+				buffer.write(in, m); // sample j is now at delay m - j
+				memset(out, 0, m * sizeof(T));
+
+				for (size_t i = 0; i < voices; i++)
+				{
+					T time = times[i];
+					T target = targets[i];
+					T gain = gains[i];
+					T state = current[i];
+
+					for (uint j = 0; j < m; j++)
+					{
+						T sample = read(m - j + time, state);
+						out[j] += gain * sample;
+						state = sample;
+						time += coefficient * (target - time);
+					}
+
+					times[i] = time;
+					current[i] = previous[i] = state;
+				}
+
+				in += m;
+				out += m;
+				n -= m;
+			}
+		}
+
+	private:
+		static constexpr uint chunk = 64; // longest span processed at once
+
+		PBuffer<T> buffer;
+		uint longest;
+		int mode = linear;
+		T coefficient; // of the delay-time smoother
+
+		T targets[voices];
+		T times[voices]; // smoothed delay times
+		T gains[voices];
+		T previous[voices]; // last output of each voice (allpass state)
+		T current[voices];
+
+		// read at a fractional delay; last is the voice's previous output
+		inline T read(T position, T last)
+		{
+			if (mode == hermite)
+				return buffer(position, Quality::hermite);
+
+			if (mode == allpass)
+			{
+				// integer part leaves a fraction in [0.5, 1.5), where the allpass is well behaved
+				int whole = (int)(position - 0.5);
+				T fraction = position - whole;
+				T eta = (1 - fraction) / (1 + fraction);
+				return eta * buffer((T)whole) + buffer((T)(whole + 1)) - eta * last;
+			}
+
+			return buffer(position);
+		}
+	};
+}
+
+#define MODULATED
+#endif
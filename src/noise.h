@@ -1,5 +1,6 @@
 // noise.h
 #include "globals.h"
+#include "rng.h"
 
 #ifndef NOISE
 
@@ -8,7 +9,7 @@ namespace soundmath
 	template <typename T> class Noise
 	{
 	public:
-		Noise(T low = -1, T high = 1) : low(low), high(high)
+		Noise(T low = -1, T high = 1, uint32_t seed = Random<T>::stream()) : low(low), high(high), generator(seed)
 		{
 			tick();
 		}
@@ -24,13 +25,28 @@ namespace soundmath
 
 		void tick()
 		{
-			value = low + ((T)rand() / RAND_MAX) * (high - low);
+			value = generator.uniform(low, high);
+		}
+
+		// restart the stream (for reproducible renders)
+		void seed(uint32_t seed)
+		{
+			generator.seed(seed);
+			tick();
+		}
+
+		// fill out[0, n) with fresh values
+		void fill(T* out, size_t n)
+		{
+			generator.uniform(out, n, low, high);
 		}
 
 	private:
 		T low;
 		T high;
 		T value;
+
+		Random<T> generator;
 	};
 }
 
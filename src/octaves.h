@@ -0,0 +1,153 @@
+// octaves.h
+#ifndef OCTAVES
+
+#include "globals.h"
+#include "buffer.h"
+#include "filter.h"
+#include "halfband.h"
+
+namespace soundmath
+{
+	// multirate octave filterbank (laplacian pyramid). level k runs at SR / 2^k: its signal is split
+	// into a lowpassed half-rate copy (passed down to level k + 1) and the band that copy can't
+	// predict, roughly [SR / 2^(k + 2), SR / 2^(k + 1)]. each band is processed at its own rate by a
+	// biquad and a gain, and the bands are summed back up through the same interpolators, so the
+	// output reconstructs the input exactly (delayed by latency()) when the bands are left alone.
+	// the whole pyramid costs about twice its top level
+	template <typename T, size_t levels = 6, size_t half = 3> class Octaves
+	{
+	public:
+		Octaves()
+		{
+			T identity[3] = {1, 0, 0};
+			T none[3] = {0, 0, 0};
+
+			for (size_t k = 0; k <= levels; k++)
+			{
+				filters[k].coefficients(identity, none);
+				gains[k] = 1;
+				outputs[k] = 0;
+			}
+
+			for (size_t k = 0; k < levels; k++)
+			{
+				aligned[k].initialize(D + 1);
+				deferred[k].initialize(2 * compensation(k + 1) + 1);
+				phases[k] = false;
+			}
+		}
+
+		~Octaves() { }
+
+		// samples of delay from input to output
+		static constexpr size_t latency()
+		{
+			return compensation(0);
+		}
+
+		// band k's biquad, running at SR / 2^k (band levels is the residual lowpass)
+		Filter<T, 2>& filter(size_t k)
+		{
+			return filters[k];
+		}
+
+		void gain(size_t k, T value)
+		{
+			gains[k] = value;
+		}
+
+		// most recent processed sample of band k (updated at SR / 2^k)
+		T band(size_t k)
+		{
+			return outputs[k];
+		}
+
+		T operator()(T sample)
+		{
+			if (!computed)
+			{
+				out = step(0, sample);
+				computed = true;
+			}
+
+			return out;
+		}
+
+		void tick()
+		{
+			computed = false;
+		}
+
+		void process(const T* in, T* out, uint n)
+		{
+			for (uint j = 0; j < n; j++)
+				out[j] = step(0, in[j]);
+			computed = false;
+		}
+
+	private:
+		static const size_t D = Halfband<T, half>::length; // delay through decimation and interpolation, at the upper rate
+
+		// delay of the reconstruction of level k, in its own samples
+		static constexpr size_t compensation(size_t k)
+		{
+			return (k >= levels) ? 0 : D + 2 * compensation(k + 1);
+		}
+
+		Halfband<T, half> down[levels]; // level k to k + 1
+		Halfband<T, half> up[levels]; // prediction of level k from k + 1
+		Halfband<T, half> expand[levels]; // reconstruction of level k from k + 1
+
+		PBuffer<T> aligned[levels]; // level k's input, delayed to meet its prediction
+		PBuffer<T> deferred[levels]; // level k's band, delayed to meet the reconstruction below it
+
+		T predictions[levels][2];
+		T expansions[levels][2];
+		bool phases[levels]; // second of each pair pending
+
+		Filter<T, 2> filters[levels + 1];
+		T gains[levels + 1];
+		T outputs[levels + 1];
+
+		T out = 0;
+		bool computed = false;
+
+		// consume one sample of level k; returns one sample of its reconstruction
+		T step(size_t k, T sample)
+		{
+			if (k == levels) // residual
+			{
+				outputs[k] = gains[k] * filters[k](sample);
+				filters[k].tick();
+				return outputs[k];
+			}
+
+			T coarse;
+			if (down[k].decimate(sample, &coarse))
+			{
+				up[k].interpolate(coarse, predictions[k]);
+				expand[k].interpolate(step(k + 1, coarse), expansions[k]);
+				phases[k] = false;
+			}
+
+			size_t i = phases[k];
+			phases[k] = !phases[k];
+
+			aligned[k].write(sample);
+			T difference = aligned[k](D) - predictions[k][i];
+			aligned[k].tick();
+
+			outputs[k] = gains[k] * filters[k](difference);
+			filters[k].tick();
+
+			deferred[k].write(outputs[k]);
+			T reconstruction = deferred[k](2 * compensation(k + 1)) + expansions[k][i];
+			deferred[k].tick();
+
+			return reconstruction;
+		}
+	};
+}
+
+#define OCTAVES
+#endif
@@ -0,0 +1,124 @@
+// pitchmarks.h
+#ifndef PITCHMARKS
+
+#include "globals.h"
+
+namespace soundmath
+{
+	// incremental pitch-mark detector; runs alongside a recording buffer and places one mark per period
+	// (at the waveform peak of each completed cycle). per-sample work is a filter and a comparison;
+	// the period estimate is only revised when a cycle completes.
+	template <typename T> class Pitchmarker
+	{
+	public:
+		static const size_t capacity = 16; // marks remembered
+
+		Pitchmarker(T low = 60, T high = 1000) :
+			shortest(SR / high), longest(SR / low)
+		{
+			smoothing = exp(-2 * PI * high / SR);
+			memset(marks, 0, capacity * sizeof(size_t));
+		}
+
+		~Pitchmarker() { }
+
+		// analyze the current sample; call before tick()
+		void write(T sample)
+		{
+			blocked = sample - previous + 0.995 * blocked; // remove DC
+			previous = sample;
+			filtered = (1 - smoothing) * blocked + smoothing * filtered;
+
+			envelope = std::max<T>(envelope * 0.9995, std::abs(filtered));
+
+			if (filtered > peak)
+			{
+				peak = filtered;
+				peaktime = now;
+			}
+
+			// a cycle is complete at an upward crossing, after the signal has swung convincingly negative
+			if (filtered < -0.25 * envelope)
+				armed = true;
+
+			if (armed && filtered >= 0 && last <= 0)
+				complete();
+
+			last = filtered;
+
+			if (now - crossing > 2 * longest) // lost the pitch
+				estimate = 0;
+		}
+
+		void tick()
+		{
+			now++;
+		}
+
+		// current period in samples (0 if unvoiced)
+		T period()
+		{
+			return estimate;
+		}
+
+		bool voiced()
+		{
+			return estimate > 0;
+		}
+
+		// delay in samples to the most recent mark (or to the nth previous one)
+		size_t latest(size_t n = 0)
+		{
+			return now - marks[(head + capacity - n) % capacity];
+		}
+
+	private:
+		T shortest, longest;
+		T smoothing;
+
+		T previous = 0, blocked = 0, filtered = 0, last = 0;
+		T envelope = 0;
+		T peak = 0;
+		T estimate = 0;
+		bool armed = false;
+
+		size_t now = 0;
+		size_t crossing = 0;
+		size_t peaktime = 0;
+
+		size_t marks[capacity];
+		size_t head = 0;
+
+		// called once per period
+		void complete()
+		{
+			T length = now - crossing;
+			armed = false;
+
+			if (length < shortest) // spurious crossing; wait for the rest of the cycle
+				return;
+
+			crossing = now;
+
+			if (length > longest)
+			{
+				estimate = 0;
+				peak = 0;
+				return;
+			}
+
+			// follow the period smoothly, but jump on octave-sized changes
+			if (estimate == 0 || std::abs(length - estimate) > 0.25 * estimate)
+				estimate = length;
+			else
+				estimate = 0.75 * estimate + 0.25 * length;
+
+			head = (head + 1) % capacity;
+			marks[head] = peaktime;
+			peak = 0;
+		}
+	};
+}
+
+#define PITCHMARKS
+#endif
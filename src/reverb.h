@@ -0,0 +1,152 @@
+// reverb.h
+#ifndef REVERB
+
+#include "globals.h"
+#include "buffer.h"
+
+namespace soundmath
+{
+	// feedback delay network: lines of prime length, a one-pole lowpass and decay gain on each,
+	// mixed back into each other by a hadamard matrix (fast walsh-hadamard transform, n log n adds).
+	// processed in spans no longer than the shortest line, with the lines as rows of a block
+	template <typename T, size_t lines = 8> class Reverb
+	{
+		static_assert((lines & (lines - 1)) == 0, "the hadamard transform needs a power-of-two number of lines");
+
+	public:
+		// total samples of delay memory for lines up to the given length (in seconds)
+		static constexpr size_t footprint(T longest = 0.1)
+		{
+			return lines * PBuffer<T>::footprint(SR * longest + chunk);
+		}
+
+		~Reverb() { }
+
+		// lines spread geometrically over [0.4, 1] * longest seconds; memory (if given) must hold footprint(longest) samples
+		Reverb(T longest = 0.1, T* memory = nullptr)
+		{
+			size_t size = SR * longest + chunk;
+			for (size_t i = 0; i < lines; i++)
+			{
+				if (memory)
+				{
+					delays[i].initialize(memory, size);
+					memory += PBuffer<T>::footprint(size);
+				}
+				else
+					delays[i].initialize(size);
+
+				T spread = pow(0.4, (T)(lines - 1 - i) / (lines - 1));
+				lengths[i] = prime(std::max<size_t>(SR * longest * spread, 2 * chunk));
+
+				states[i] = 0;
+				signs[i] = (i & 1) ? -1 : 1; // decorrelate injection and pickup
+			}
+
+			decay(2);
+			damping(0.3);
+		}
+
+		// time (seconds) for the tail to fall by 60 dB
+		void decay(T seconds)
+		{
+			for (size_t i = 0; i < lines; i++)
+				gains[i] = pow(10, -3 * (T)lengths[i] / (SR * seconds));
+		}
+
+		// high-frequency loss per pass, in [0, 1)
+		void damping(T amount)
+		{
+			lowpass = std::clamp<T>(amount, 0, 0.99);
+		}
+
+		// wet signal for n samples of input (in and out may be the same array)
+		void process(const T* in, T* out, uint n)
+		{
+			static const T scale = 1 / sqrt((T)lines); // makes the hadamard matrix orthogonal
+
+			T block[lines][chunk];
+			T input[chunk];
+
+			while (n > 0)
+			{
+				uint m = std::min(n, chunk);
+				memcpy(input, in, m * sizeof(T));
+				memset(out, 0, m * sizeof(T));
+
+				// line outputs, damped, then picked up
+				for (size_t i = 0; i < lines; i++)
+				{
+					T* row = block[i];
+					delays[i].read(row, lengths[i] - m + 1, m);
+
+					T state = states[i];
+					T gain = gains[i];
+					for (uint j = 0; j < m; j++)
+					{
+						state = (1 - lowpass) * row[j] + lowpass * state;
+						row[j] = gain * state;
+					}
+					states[i] = state;
+
+					for (uint j = 0; j < m; j++)
+						out[j] += signs[i] * scale * row[j];
+				}
+
+				// feedback matrix, butterflies on whole rows
+				for (size_t h = 1; h < lines; h <<= 1)
+					for (size_t i = 0; i < lines; i += 2 * h)
+						for (size_t k = i; k < i + h; k++)
+						{
+							T* a = block[k];
+							T* b = block[k + h];
+							for (uint j = 0; j < m; j++)
+							{
+								T sum = a[j] + b[j];
+								b[j] = a[j] - b[j];
+								a[j] = sum;
+							}
+						}
+
+				for (size_t i = 0; i < lines; i++)
+				{
+					T* row = block[i];
+					for (uint j = 0; j < m; j++)
+						row[j] = scale * row[j] + signs[i] * input[j];
+					delays[i].write(row, m);
+				}
+
+				in += m;
+				out += m;
+				n -= m;
+			}
+		}
+
+	private:
+		static constexpr uint chunk = 32; // longest span processed at once
+
+		PBuffer<T> delays[lines];
+		size_t lengths[lines]; // in samples
+		T gains[lines]; // per-pass decay
+		T states[lines]; // damping filters
+		T signs[lines];
+		T lowpass;
+
+		// largest prime not above n
+		static size_t prime(size_t n)
+		{
+			for (; n > 2; n--)
+			{
+				bool composite = false;
+				for (size_t d = 2; d * d <= n && !composite; d++)
+					composite = (n % d == 0);
+				if (!composite)
+					return n;
+			}
+			return 2;
+		}
+	};
+}
+
+#define REVERB
+#endif
@@ -0,0 +1,174 @@
+// rng.h
+#ifndef RNG
+
+#include "globals.h"
+#include <cstdint>
+
+namespace soundmath
+{
+	// xoshiro128+ generator with per-object seeded streams
+	// the scalar stream and the block stream are independent; both are reproducible from the seed
+	template <typename T> class Random
+	{
+	public:
+		static const size_t lanes = 4; // interleaved generators used by the block-fill methods
+
+		Random(uint32_t seed = stream())
+		{
+			this->seed(seed);
+		}
+
+		~Random() { }
+
+		// restart the stream; equal seeds produce bit-identical sequences
+		void seed(uint32_t seed)
+		{
+			uint64_t mixer = seed;
+			for (size_t i = 0; i < 4; i++)
+				state[i] = splitmix(mixer);
+
+			for (size_t i = 0; i < 4; i++)
+				for (size_t j = 0; j < lanes; j++)
+					block[i][j] = splitmix(mixer);
+
+			spare = false;
+		}
+
+		// next raw 32-bit output
+		inline uint32_t next()
+		{
+			uint32_t result = state[0] + state[3];
+			uint32_t t = state[1] << 9;
+
+			state[2] ^= state[0];
+			state[3] ^= state[1];
+			state[1] ^= state[2];
+			state[0] ^= state[3];
+			state[2] ^= t;
+			state[3] = rotate(state[3], 11);
+
+			return result;
+		}
+
+		// uniform in [0, 1)
+		inline T uniform()
+		{
+			return unit(next());
+		}
+
+		// uniform in [low, high)
+		inline T uniform(T low, T high)
+		{
+			return low + uniform() * (high - low);
+		}
+
+		// standard normal (Box-Muller; the second variate of each pair is kept for the next call)
+		T gaussian()
+		{
+			if (spare)
+			{
+				spare = false;
+				return cached;
+			}
+
+			T radius = sqrt(-2 * log(1 - uniform()));
+			T theta = 2 * PI * uniform();
+
+			cached = radius * sin(theta);
+			spare = true;
+			return radius * cos(theta);
+		}
+
+		// fill out[0, n) with uniforms in [low, high); the lanes advance in lockstep, so the loop vectorizes
+		void uniform(T* out, size_t n, T low = 0, T high = 1)
+		{
+			T scale = high - low;
+			size_t i = 0;
+			for (; i + lanes <= n; i += lanes)
+			{
+				uint32_t values[lanes];
+				step(values);
+				for (size_t j = 0; j < lanes; j++)
+					out[i + j] = low + unit(values[j]) * scale;
+			}
+
+			for (; i < n; i++)
+				out[i] = low + uniform() * scale;
+		}
+
+		// fill out[0, n) with normal variates of given mean and deviation
+		void gaussian(T* out, size_t n, T mean = 0, T deviation = 1)
+		{
+			size_t i = 0;
+			for (; i + 2 * lanes <= n; i += 2 * lanes)
+			{
+				uint32_t first[lanes], second[lanes];
+				step(first);
+				step(second);
+				for (size_t j = 0; j < lanes; j++)
+				{
+					T radius = deviation * sqrt(-2 * log(1 - unit(first[j])));
+					T theta = 2 * PI * unit(second[j]);
+					out[i + j] = mean + radius * cos(theta);
+					out[i + lanes + j] = mean + radius * sin(theta);
+				}
+			}
+
+			for (; i < n; i++)
+				out[i] = mean + deviation * gaussian();
+		}
+
+		// distinct default seeds, handed out in construction order (so programs are reproducible run-to-run)
+		static uint32_t stream()
+		{
+			static uint32_t count = 0;
+			return 0x9e3779b9 * ++count;
+		}
+
+	private:
+		uint32_t state[4];
+		uint32_t block[4][lanes]; // structure-of-arrays states for the block generators
+
+		bool spare;
+		T cached;
+
+		static inline uint32_t rotate(uint32_t x, int k)
+		{
+			return (x << k) | (x >> (32 - k));
+		}
+
+		// maps the top 24 bits to [0, 1) without a division
+		static inline T unit(uint32_t x)
+		{
+			return (T)(x >> 8) * (T)(1.0 / 16777216.0);
+		}
+
+		static uint32_t splitmix(uint64_t& x)
+		{
+			uint64_t z = (x += 0x9e3779b97f4a7c15);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+			return (uint32_t)((z ^ (z >> 31)) >> 32);
+		}
+
+		// advance every block lane once
+		inline void step(uint32_t* values)
+		{
+			for (size_t j = 0; j < lanes; j++)
+			{
+				values[j] = block[0][j] + block[3][j];
+				uint32_t t = block[1][j] << 9;
+
+				block[2][j] ^= block[0][j];
+				block[3][j] ^= block[1][j];
+				block[1][j] ^= block[2][j];
+				block[0][j] ^= block[3][j];
+				block[2][j] ^= t;
+				block[3][j] = rotate(block[3][j], 11);
+			}
+		}
+	};
+}
+
+#define RNG
+#endif
@@ -0,0 +1,413 @@
+// stream.h
+#ifndef STREAM
+
+#include "globals.h"
+#include <atomic>
+#include <cstdio>
+
+namespace soundmath
+{
+	// where streamed samples go to or come from; implementations may block (they are only
+	// called from Stream::service(), never from the audio callback)
+	template <typename T> class Port
+	{
+	public:
+		virtual ~Port() { }
+
+		virtual size_t read(T* out, size_t n) = 0; // returns samples read (0 at the end)
+		virtual size_t write(const T* in, size_t n) = 0; // returns samples written
+		virtual void rewind() { }
+		virtual void flush() { }
+	};
+
+	// raw samples in a file on the host filesystem
+	template <typename T> class FilePort : public Port<T>
+	{
+	public:
+		// mode as for fopen: "rb" to play, "wb" to record
+		FilePort(const char* path, const char* mode)
+		{
+			file = fopen(path, mode);
+		}
+
+		~FilePort()
+		{
+			if (file)
+				fclose(file);
+		}
+
+		bool is_open()
+		{
+			return file != nullptr;
+		}
+
+		size_t read(T* out, size_t n)
+		{
+			return file ? fread(out, sizeof(T), n, file) : 0;
+		}
+
+		size_t write(const T* in, size_t n)
+		{
+			return file ? fwrite(in, sizeof(T), n, file) : 0;
+		}
+
+		void rewind()
+		{
+			if (file)
+				::rewind(file);
+		}
+
+		void flush()
+		{
+			if (file)
+				fflush(file);
+		}
+
+	private:
+		FILE* file;
+	};
+
+	// double-buffered streaming between the audio callback and a Port. the callback side
+	// (capture / playback) only touches memory and atomics; service() does the I/O from the main loop.
+	// each chunk is owned by one side at a time, and ownership changes hands through an atomic flag.
+	// record(), play() and stop() only post a command, which the callback carries out at its next
+	// capture() or playback() (so call one of them every sample, even while idle). chunks are tagged
+	// with the session they belong to, so a new session never mixes with data left from the last
+	template <typename T, size_t chunk = 4096> class Stream
+	{
+	public:
+		static const int idle = 0;
+		static const int recording = 1;
+		static const int playing = 2;
+
+		Stream(Port<T>* port) : port(port)
+		{
+			for (size_t i = 0; i < 2; i++)
+			{
+				counts[i] = 0;
+				sessions[i] = 0;
+				serials[i] = 0;
+				owners[i] = audio;
+			}
+		}
+
+		~Stream() { }
+
+		// control side: start recording / playing from the beginning, or stop
+		void record()
+		{
+			command.store(recording, std::memory_order_release);
+		}
+
+		void play(bool loop = false)
+		{
+			looping = loop;
+			command.store(playing, std::memory_order_release);
+		}
+
+		void stop()
+		{
+			command.store(halt, std::memory_order_release);
+		}
+
+		// audio side: append a sample to the recording (e.g. the value just written to a Buffer)
+		inline void capture(T sample)
+		{
+			if (command.load(std::memory_order_relaxed) != none)
+				obey();
+
+			if (mode.load(std::memory_order_relaxed) != recording)
+				return;
+
+			if (!owned) // both chunks were with service() when recording began
+			{
+				if (owners[current].load(std::memory_order_acquire) != audio)
+					return;
+				owned = true;
+			}
+
+			chunks[current][position++] = sample;
+			if (position == chunk)
+				handoff();
+		}
+
+		void capture(const T* in, size_t n)
+		{
+			for (size_t i = 0; i < n; i++)
+				capture(in[i]);
+		}
+
+		// audio side: next sample of the playback (e.g. to write into a Buffer); zero on underrun
+		inline T playback()
+		{
+			if (command.load(std::memory_order_relaxed) != none)
+				obey();
+
+			if (mode.load(std::memory_order_relaxed) != playing)
+				return 0;
+
+			if (position == available && !advance())
+				return 0;
+
+			return chunks[current][position++];
+		}
+
+		void playback(T* out, size_t n)
+		{
+			for (size_t i = 0; i < n; i++)
+				out[i] = playback();
+		}
+
+		// main loop: move recorded chunks to the port, and refill played ones
+		void service()
+		{
+			// read before the chunks: anything handed off before the callback went idle is seen below
+			int state = mode.load(std::memory_order_acquire);
+
+			drain();
+			for (size_t i = 0; i < 2; i++)
+			{
+				if (owners[i].load(std::memory_order_acquire) != spent)
+					continue;
+
+				if (sessions[i] > latest) // a new playback: finish the old session's writes, then start over
+				{
+					drain();
+					begin(sessions[i]);
+				}
+
+				if (sessions[i] == latest)
+					fill(i);
+				else // left from an earlier session; the callback will hand it back again
+				{
+					counts[i] = 0;
+					owners[i].store(audio, std::memory_order_release);
+				}
+			}
+
+			if (state == idle && !finished)
+			{
+				port->flush();
+				finished = true;
+			}
+		}
+
+		int status()
+		{
+			return mode.load(std::memory_order_relaxed);
+		}
+
+	public:
+		std::atomic<uint32_t> underruns{0}; // playback samples lost waiting for the port
+		std::atomic<uint32_t> overruns{0}; // recorded chunks dropped because the port fell behind
+
+	private:
+		static const int audio = 0; // chunk belongs to the callback
+		static const int full = 1; // recorded; belongs to service() until written
+		static const int spent = 2; // played; belongs to service() until refilled
+
+		static const int none = 0; // commands (besides recording and playing)
+		static const int halt = 3;
+
+		Port<T>* port;
+		T chunks[2][chunk];
+		size_t counts[2]; // valid samples per chunk
+		uint32_t sessions[2]; // session that last handed each chunk over
+		uint32_t serials[2]; // order in which chunks were recorded, or filled for playback
+		std::atomic<int> owners[2];
+
+		std::atomic<int> mode{idle}; // written by the callback only
+		std::atomic<int> command{none};
+
+		// callback side
+		uint32_t session = 0;
+		size_t current = 0; // chunk in use
+		size_t position = 0; // position within it
+		size_t available = 0; // playback: samples in the current chunk
+		bool returned = true; // playback: current chunk already handed back for refilling
+		bool owned = true; // recording: current chunk is ours to write
+		uint32_t expected = 0; // playback: serial of the next chunk
+		uint32_t waited = 0; // playback: samples waiting since the last chunk ran out
+		bool started = false; // playback: first chunk has arrived
+		uint32_t handed = 0; // recording: chunks handed over so far
+
+		// service side
+		uint32_t latest = 0; // newest session seen
+		uint32_t fills = 0; // chunks filled this session
+		bool looping = false;
+		bool finished = true; // nothing left to flush
+
+		// callback: carry out the latest command
+		void obey()
+		{
+			int next = command.exchange(none, std::memory_order_acquire);
+
+			if (mode.load(std::memory_order_relaxed) == recording && position > 0)
+				release(current, full, position); // keep what was recorded
+
+			session++;
+			position = 0;
+			if (next != halt) // counts stay readable after a stop
+			{
+				underruns = 0;
+				overruns = 0;
+			}
+
+			if (next == recording)
+			{
+				// start in a chunk we own, if there is one
+				owned = owners[current].load(std::memory_order_acquire) == audio;
+				if (!owned && owners[1 - current].load(std::memory_order_acquire) == audio)
+				{
+					current = 1 - current;
+					owned = true;
+				}
+			}
+			else if (next == playing)
+			{
+				// everything we hold goes back to be filled from the start
+				for (size_t i = 0; i < 2; i++)
+					if (owners[i].load(std::memory_order_acquire) == audio)
+						release(i, spent, 0);
+
+				available = 0;
+				returned = true;
+				expected = 0;
+				waited = 0;
+				started = false;
+			}
+
+			mode.store(next == halt ? idle : next, std::memory_order_release);
+		}
+
+		void release(size_t i, int state, size_t count)
+		{
+			counts[i] = count;
+			sessions[i] = session;
+			if (state == full)
+				serials[i] = handed++;
+			owners[i].store(state, std::memory_order_release);
+		}
+
+		// recording: pass the full chunk to service(), continue in the other
+		void handoff()
+		{
+			size_t other = 1 - current;
+			if (owners[other].load(std::memory_order_acquire) != audio)
+			{
+				overruns++; // port still busy with the other chunk: drop this one
+				position = 0;
+				return;
+			}
+
+			release(current, full, position);
+			current = other;
+			position = 0;
+		}
+
+		// playback: return the exhausted chunk for refilling and switch to the next, if it's ready
+		bool advance()
+		{
+			if (!returned)
+			{
+				release(current, spent, 0);
+				returned = true;
+			}
+
+			for (size_t i = 0; i < 2; i++)
+			{
+				if (owners[i].load(std::memory_order_acquire) != audio)
+					continue;
+
+				if (sessions[i] != session) // left from an earlier session
+				{
+					release(i, spent, 0);
+					continue;
+				}
+
+				if (serials[i] != expected)
+					continue;
+
+				if (counts[i] == 0) // end of the port's data: stop, and the wait wasn't an underrun
+				{
+					mode.store(idle, std::memory_order_release);
+					return false;
+				}
+
+				if (started)
+					underruns += waited;
+				started = true;
+				waited = 0;
+
+				current = i;
+				position = 0;
+				available = counts[i];
+				returned = false;
+				expected++;
+				return true;
+			}
+
+			waited++;
+			return false;
+		}
+
+		// service: write recorded chunks, oldest first
+		void drain()
+		{
+			bool ready[2];
+			for (size_t i = 0; i < 2; i++)
+				ready[i] = owners[i].load(std::memory_order_acquire) == full;
+
+			size_t order[2] = {0, 1};
+			if (ready[0] && ready[1] && (int32_t)(serials[1] - serials[0]) < 0)
+				std::swap(order[0], order[1]);
+
+			for (size_t i : order)
+			{
+				if (!ready[i])
+					continue;
+
+				if (sessions[i] > latest)
+					begin(sessions[i]);
+
+				if (sessions[i] == latest)
+				{
+					port->write(chunks[i], counts[i]);
+					finished = false;
+				}
+
+				counts[i] = 0;
+				owners[i].store(audio, std::memory_order_release);
+			}
+		}
+
+		// service: a new session starts at the beginning of the port
+		void begin(uint32_t id)
+		{
+			if (!finished)
+			{
+				port->flush();
+				finished = true;
+			}
+			port->rewind();
+			latest = id;
+			fills = 0;
+		}
+
+		void fill(size_t i)
+		{
+			counts[i] = port->read(chunks[i], chunk);
+			if (counts[i] < chunk && looping)
+			{
+				port->rewind();
+				counts[i] += port->read(chunks[i] + counts[i], chunk - counts[i]);
+			}
+
+			serials[i] = fills++;
+			owners[i].store(audio, std::memory_order_release);
+		}
+	};
+}
+
+#define STREAM
+#endif
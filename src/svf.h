@@ -0,0 +1,175 @@
+// svf.h
+#ifndef SVFh
+
+#include "globals.h"
+
+namespace soundmath
+{
+	// trapezoidal (topology-preserving) state variable filter, made for modulation: tune() looks up
+	// the prewarped cutoff in a table at control rate, and the coefficients glide linearly to it
+	// sample by sample. the state stays valid whatever the coefficients do, so sweeps don't click
+	template <typename T> class SVF
+	{
+	public:
+		static const int lowpass = 0;
+		static const int bandpass = 1;
+		static const int highpass = 2;
+		static const int notch = 3;
+		static const int peak = 4;
+
+		SVF(int mode = lowpass, T frequency = 1000, T Q = 0.7071) : mode(mode)
+		{
+			tune(frequency, Q, 0);
+			reset();
+		}
+
+		~SVF() { }
+
+		void reset()
+		{
+			ic1 = ic2 = 0;
+			out = 0;
+			computed = false;
+		}
+
+		void shape(int mode)
+		{
+			this->mode = mode;
+		}
+
+		// new cutoff and resonance, reached after glide samples (0 jumps immediately)
+		void tune(T frequency, T Q, uint glide = 32)
+		{
+			T g = prewarp(frequency);
+			T k = 1 / std::max<T>(Q, 0.01);
+
+			T targets[4];
+			targets[0] = 1 / (1 + g * (g + k));
+			targets[1] = g * targets[0];
+			targets[2] = g * targets[1];
+			targets[3] = k;
+
+			for (size_t i = 0; i < 4; i++)
+			{
+				if (glide == 0)
+					coeffs[i] = targets[i];
+				steps[i] = glide ? (targets[i] - coeffs[i]) / glide : 0;
+			}
+			remaining = glide;
+		}
+
+		T operator()(T sample)
+		{
+			if (!computed)
+			{
+				out = step(sample, coeffs, ic1, ic2);
+				computed = true;
+			}
+
+			return out;
+		}
+
+		void tick()
+		{
+			if (remaining > 0)
+			{
+				for (size_t i = 0; i < 4; i++)
+					coeffs[i] += steps[i];
+				remaining--;
+			}
+			computed = false;
+		}
+
+		// filter n samples (equivalent to n calls of operator() then tick()); in and out may be the same
+		void process(const T* in, T* out, uint n)
+		{
+			T c[4] = {coeffs[0], coeffs[1], coeffs[2], coeffs[3]};
+			T s1 = ic1, s2 = ic2;
+
+			uint gliding = std::min(n, remaining);
+			for (uint j = 0; j < gliding; j++)
+			{
+				out[j] = step(in[j], c, s1, s2);
+				for (size_t i = 0; i < 4; i++)
+					c[i] += steps[i];
+			}
+
+			for (uint j = gliding; j < n; j++)
+				out[j] = step(in[j], c, s1, s2);
+
+			for (size_t i = 0; i < 4; i++)
+				coeffs[i] = c[i];
+			remaining -= gliding;
+			ic1 = s1;
+			ic2 = s2;
+			computed = false;
+		}
+
+	private:
+		int mode;
+		T coeffs[4]; // a1, a2, a3, k
+		T steps[4];
+		uint remaining = 0; // samples left in the glide
+
+		T ic1, ic2; // integrator states
+		T out;
+		bool computed;
+
+		inline T step(T sample, const T* c, T& s1, T& s2)
+		{
+			T v3 = sample - s2;
+			T v1 = c[0] * s1 + c[1] * v3;
+			T v2 = s2 + c[1] * s1 + c[2] * v3;
+			s1 = 2 * v1 - s1;
+			s2 = 2 * v2 - s2;
+
+			switch (mode)
+			{
+				case bandpass: return v1;
+				case highpass: return sample - c[3] * v1 - v2;
+				case notch: return sample - c[3] * v1;
+				case peak: return 2 * v2 - sample + c[3] * v1;
+				default: return v2;
+			}
+		}
+
+		// tan(pi f / SR), from a table spaced linearly within each octave (so frexp finds the index)
+		static T prewarp(T frequency)
+		{
+			static const Table table;
+
+			int exponent;
+			T mantissa = frexp(std::max<T>(frequency, lowest) / lowest, &exponent); // in [0.5, 1)
+			T position = ((exponent - 1) + (2 * mantissa - 1)) * Table::density;
+			position = std::min<T>(position, Table::points - 1);
+			size_t index = std::min<size_t>((size_t)position, Table::points - 2);
+			T disp = position - index;
+
+			return table.values[index] + disp * (table.values[index + 1] - table.values[index]);
+		}
+
+		static constexpr T lowest = 10; // Hz
+
+		struct Table
+		{
+			static const size_t density = 64; // points per octave
+			static const size_t points = 11 * density + 1; // up to 20 kHz
+
+			T values[points];
+
+			Table()
+			{
+				for (size_t i = 0; i < points; i++)
+				{
+					size_t octave = i / density;
+					T fraction = (T)(i % density) / density;
+					T frequency = std::min<T>(lowest * (1 << octave) * (1 + fraction), 0.49 * SR);
+					values[i] = tan(PI * frequency / SR);
+				}
+			}
+		};
+	};
+}
+
+#define SVFh
+#endif
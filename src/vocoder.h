@@ -0,0 +1,119 @@
+// vocoder.h
+#ifndef VOCODER
+
+#include "globals.h"
+#include "bank.h"
+#include "synth.h"
+
+namespace soundmath
+{
+	// channel vocoder: a bank of bandpass filters analyzes the modulator, followers track each band's
+	// envelope, and a matching bank shapes the carrier (an input, or a Synth) with those envelopes.
+	// filters and followers run structure-of-arrays across the bands; latency is the filters' own
+	template <typename T, size_t bands = 16> class Vocoder
+	{
+	public:
+		// bands spaced logarithmically between low and high (Hz), each Q wide
+		Vocoder(T low = 100, T high = 8000, T Q = 8, Synth<T>* carrier = nullptr) :
+			analysis(0, 0), synthesis(0, 0), carrier(carrier)
+		{
+			for (size_t i = 0; i < bands; i++)
+			{
+				T frequency = low * pow(high / low, (T)i / std::max<size_t>(bands - 1, 1));
+
+				// unity-peak bandpass biquad
+				T theta = 2 * PI * frequency / SR;
+				T alpha = sin(theta) / (2 * Q);
+				T b0 = alpha / (1 + alpha);
+				std::vector<T> forward = {b0, 0, -b0};
+				std::vector<T> back = {-2 * (T)cos(theta) / (1 + alpha), (1 - alpha) / (1 + alpha)};
+
+				analysis.coefficients(i, forward, back);
+				synthesis.coefficients(i, forward, back);
+				analysis.boost(i, 1);
+				synthesis.boost(i, 1);
+
+				envelopes[i] = 0;
+			}
+
+			follow(0.002, 0.05);
+		}
+
+		~Vocoder() { }
+
+		// follower attack and release times, in seconds
+		void follow(T attack, T release)
+		{
+			this->attack = 1 - relaxation(attack);
+			this->release = 1 - relaxation(release);
+		}
+
+		// the carrier is the internal Synth
+		T operator()(T modulator)
+		{
+			return (*this)(modulator, carrier ? (*carrier)() : 0);
+		}
+
+		T operator()(T modulator, T excitation)
+		{
+			if (!computed)
+			{
+				analysis(modulator);
+				const T* levels = analysis.bands();
+
+				for (size_t i = 0; i < bands; i++)
+				{
+					T level = std::abs(levels[i]);
+					T rate = (level > envelopes[i]) ? attack : release;
+					envelopes[i] += rate * (level - envelopes[i]);
+				}
+
+				synthesis.mix(envelopes);
+				out = gain * synthesis(excitation);
+				computed = true;
+			}
+
+			return out;
+		}
+
+		void tick()
+		{
+			analysis.tick();
+			synthesis.tick();
+			if (carrier)
+				carrier->tick();
+			computed = false;
+		}
+
+		// n samples against an input carrier (or the Synth, if carriers is null)
+		void process(const T* modulators, const T* carriers, T* out, uint n)
+		{
+			for (uint j = 0; j < n; j++)
+			{
+				out[j] = carriers ? (*this)(modulators[j], carriers[j]) : (*this)(modulators[j]);
+				tick();
+			}
+		}
+
+		// make-up gain (band envelopes are small compared to the modulator)
+		void level(T value)
+		{
+			gain = value;
+		}
+
+	private:
+		Bank<T, bands, 2> analysis;
+		Bank<T, bands, 2> synthesis;
+		Synth<T>* carrier;
+
+		T envelopes[bands];
+		T attack, release; // follower coefficients
+		T gain = 4;
+
+		T out = 0;
+		bool computed = false;
+	};
+}
+
+#define VOCODER
+#endif
@@ -0,0 +1,94 @@
+// windows.h
+#ifndef WINDOWS
+
+#include "globals.h"
+
+namespace soundmath
+{
+	// family of grain windows in precomputed tables, ordered so that neighbors morph smoothly:
+	// hann, tukey (1/3 and 2/3 plateau), trapezoid, percussive (two decay rates).
+	// a shape in [0, 1] selects a point between two adjacent tables
+	template <typename T, size_t resolution = 1024> class Windows
+	{
+	public:
+		static const size_t count = 6;
+
+		Windows()
+		{
+			for (size_t i = 0; i <= resolution; i++)
+			{
+				T x = (T)i / resolution;
+				tables[0][i] = 0.5 * (1 - cos(2 * PI * x));
+				tables[1][i] = tukey(x, 1.0 / 3);
+				tables[2][i] = tukey(x, 2.0 / 3);
+				tables[3][i] = std::min<T>(1, std::min(x, 1 - x) / 0.1);
+				tables[4][i] = percussive(x, 6);
+				tables[5][i] = percussive(x, 12);
+			}
+		}
+
+		~Windows() { }
+
+		// a window resolved for one grain: the two tables to blend and their weight
+		struct Selection
+		{
+			const T* lower;
+			const T* upper;
+			T weight;
+		};
+
+		Selection select(T shape)
+		{
+			T position = std::clamp<T>(shape, 0, 1) * (count - 1);
+			size_t index = std::min<size_t>((size_t)position, count - 2);
+
+			return {tables[index], tables[index + 1], position - index};
+		}
+
+		// evaluate a selection at phase in [0, 1]
+		static inline T lookup(const Selection& selection, T phase)
+		{
+			T position = std::clamp<T>(phase, 0, 1) * resolution;
+			size_t center = std::min<size_t>((size_t)position, resolution - 1);
+			T disp = position - center;
+
+			T lower = selection.lower[center] + disp * (selection.lower[center + 1] - selection.lower[center]);
+			T upper = selection.upper[center] + disp * (selection.upper[center + 1] - selection.upper[center]);
+
+			return lower + selection.weight * (upper - lower);
+		}
+
+		T operator()(T shape, T phase)
+		{
+			return lookup(select(shape), phase);
+		}
+
+	private:
+		T tables[count][resolution + 1]; // one guard point, so lookups never wrap
+
+		// cosine tapers of total fraction (1 - plateau) around a flat top
+		static T tukey(T x, T plateau)
+		{
+			T taper = (1 - plateau) / 2;
+			if (x < taper)
+				return 0.5 * (1 - cos(PI * x / taper));
+			if (x > 1 - taper)
+				return 0.5 * (1 - cos(PI * (1 - x) / taper));
+			return 1;
+		}
+
+		// 2% attack, then exponential decay (reaching zero at the end)
+		static T percussive(T x, T rate)
+		{
+			const T attack = 0.02;
+			if (x < attack)
+				return 0.5 * (1 - cos(PI * x / attack));
+
+			T floor = exp(-rate);
+			return (exp(-rate * (x - attack) / (1 - attack)) - floor) / (1 - floor);
+		}
+	};
+}
+
+#define WINDOWS
+#endif
@@ -0,0 +1,52 @@
+// loudness.cpp
+// host check of Loudness's integrated and momentary readings on short steady tones
+// build: g++ -std=gnu++17 -O2 -I../src loudness.cpp -o loudness && ./loudness
+
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include "loudness.h"
+
+using namespace soundmath;
+
+// a 997 Hz sine of amplitude 0.1 reads -23.01 LUFS however long it lasts; tolerance as in EBU Tech 3341
+bool check(double seconds)
+{
+	const double amplitude = 0.1;
+	const double expected = -3.01 + 20 * log10(amplitude);
+
+	std::vector<float> x(seconds * SR);
+	for (size_t i = 0; i < x.size(); i++)
+		x[i] = amplitude * sin(2 * PI * 997 * i / SR);
+
+	Loudness<float> meter;
+	meter.process(x.data(), x.size());
+	Loudness<float>::Reading reading = meter.read();
+
+	bool ok = std::abs(reading.integrated - expected) < 0.1 && std::abs(reading.momentary - expected) < 0.1;
+	ok &= (seconds < 3) ? reading.shortterm < -100 : std::abs(reading.shortterm - expected) < 0.1; // 3 s window
+	printf("%s %5.1f s: integrated %.3f LUFS, momentary %.3f LUFS, short-term %.3f LUFS (expected %.3f)\n",
+		ok ? "ok  " : "FAIL", seconds, reading.integrated, reading.momentary, reading.shortterm, expected);
+	return ok;
+}
+
+int main()
+{
+	bool ok = true;
+
+	// the shortest tone that fills one 400 ms block, and a few longer ones
+	ok &= check(0.4);
+	ok &= check(0.5);
+	ok &= check(3);
+	ok &= check(10);
+
+	// before 400 ms there's nothing to measure yet
+	Loudness<float> meter;
+	std::vector<float> x(SR / 5, 0.1f);
+	meter.process(x.data(), x.size());
+	bool quiet = meter.read().integrated < -100 && meter.read().momentary < -100;
+	printf("%s   0.2 s: no reading yet\n", quiet ? "ok  " : "FAIL");
+	ok &= quiet;
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+// truepeak.cpp
+// host check of Loudness's true-peak detector against analytic inter-sample peaks
+// build: g++ -std=gnu++17 -O2 -I../src truepeak.cpp -o truepeak && ./truepeak
+
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include "loudness.h"
+
+using namespace soundmath;
+
+// a sine of amplitude 0.5 peaks at -6.02 dBTP wherever its samples fall; tolerance as in EBU Tech 3341
+bool check(double frequency, double phase)
+{
+	const double amplitude = 0.5;
+	const double expected = 20 * log10(amplitude);
+
+	std::vector<float> x(SR);
+	double sampled = 0;
+	for (size_t i = 0; i < x.size(); i++)
+	{
+		x[i] = amplitude * sin(2 * PI * frequency * i / SR + phase);
+		sampled = std::max<double>(sampled, std::abs(x[i]));
+	}
+
+	Loudness<float> meter;
+	meter.process(x.data(), x.size());
+	double peak = meter.read().peak;
+
+	bool ok = peak > expected - 0.4 && peak < expected + 0.2;
+	printf("%s %6.0f Hz, phase %.3f: %.3f dBTP (sample peak %.3f dBFS, expected %.3f)\n",
+		ok ? "ok  " : "FAIL", frequency, phase, peak, 20 * log10(sampled), expected);
+	return ok;
+}
+
+int main()
+{
+	bool ok = true;
+
+	// fs / 4 at phase pi / 8: every crest falls between samples, and the sample peak reads 0.69 dB low
+	ok &= check(SR / 4, PI / 8);
+	ok &= check(SR / 4, PI / 4);
+	ok &= check(SR / 4, 3 * PI / 16);
+	ok &= check(SR / 8, PI / 8);
+	ok &= check(997, 0);
+
+	return ok ? 0 : 1;
+}
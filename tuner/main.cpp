@@ -40,6 +40,8 @@ S data2[SR / 20 + 1];
 
 FBuffer<S> clean(data1, SR / 20 + 1);
 FBuffer<S> dirty(data2, SR / 20 + 1);
+S clean_block[bsize]; // recorded a block at a time
+S dirty_block[bsize];
 
 S clean_size = 1;
 S dirty_size = 1;
@@ -193,8 +195,8 @@ static void Callback(AudioHandle::InterleavingInputBuffer in,
 		S in_sample = adc_gain * in[i];
 		S out_sample = post_gain * drive.Process(in_sample);
 
-		clean.write(in_sample);
-		dirty.write(out_sample);
+		clean_block[i / 2] = in_sample;
+		dirty_block[i / 2] = out_sample;
 
 		clean_size = size_damping * clean_size + (1 - size_damping) * in_sample * in_sample;
 		dirty_size = size_damping * dirty_size + (1 - size_damping) * out_sample * out_sample;
@@ -266,17 +268,21 @@ static void Callback(AudioHandle::InterleavingInputBuffer in,
 			S clean_scaling = 32 * 0.875 / std::max((S)0.125, std::sqrt(clean_size));
 			S dirty_scaling = 32 * 0.875 / std::max((S)0.125, std::sqrt(dirty_size));
 
-			hw.display.DrawPixel(3 * width / 4 + clean_scaling * in_sample, height / 2 + clean_scaling * clean(SR / 20), true);
-			hw.display.DrawPixel(width / 4 + dirty_scaling * out_sample, height / 2 + dirty_scaling * dirty(SR / 20), true);
+			// the block is recorded at the end of the callback: sample i / 2 of this block will land at
+			// delay -(i / 2), so the sample SR / 20 before it is at SR / 20 - i / 2 (the delay the
+			// per-sample code read between its write() and tick())
+			size_t lag = SR / 20 - i / 2;
+			hw.display.DrawPixel(3 * width / 4 + clean_scaling * in_sample, height / 2 + clean_scaling * clean(lag), true);
+			hw.display.DrawPixel(width / 4 + dirty_scaling * out_sample, height / 2 + dirty_scaling * dirty(lag), true);
 		}
 
 		out[i] = out_sample;
 		out[i + 1] = out_sample;
-
-		clean.tick();
-		dirty.tick();
 	}
 
+	clean.write(clean_block, size / 2);
+	dirty.write(dirty_block, size / 2);
+
 	hw.SetLed((Pedal::LedI)0, effectOn);
 }
 